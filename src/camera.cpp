@@ -207,32 +207,18 @@ void Camera::Draw() {
         for (int p = 0; p < Room::NUM_PLANES; ++p) {
             auto pid = (Room::PlaneID) p;
 
-            // This is a hack. This global transformation should really be in the dcdraw lib
-            glMatrixMode(GL_MODELVIEW);
-            glLoadIdentity();
-            glTranslatef(window.x, window.y, 0);
-            glTranslatef(-plane_offset_x[p], -plane_offset_y[p], 0);
-
+            DCDraw::SetViewOffset(window.x - plane_offset_x[p], window.y - plane_offset_y[p]);
             room->Draw(pid);
-
-            glMatrixMode(GL_MODELVIEW);
-            glLoadIdentity();
+            DCDraw::SetViewOffset(0, 0);
         }
 
         // draw actor chat texts
         for (int p = 0; p < Room::NUM_PLANES; ++p) {
             auto pid = (Room::PlaneID) p;
 
-            // This is a hack. This global transformation should really be in the dcdraw lib
-            glMatrixMode(GL_MODELVIEW);
-            glLoadIdentity();
-            glTranslatef(window.x, window.y, 0);
-            glTranslatef(-plane_offset_x[p], -plane_offset_y[p], 0);
-
+            DCDraw::SetViewOffset(window.x - plane_offset_x[p], window.y - plane_offset_y[p]);
             room->DrawActorTexts(pid);
-
-            glMatrixMode(GL_MODELVIEW);
-            glLoadIdentity();
+            DCDraw::SetViewOffset(0, 0);
         }
 
         DCDraw::OpenGLClipScreen(false);
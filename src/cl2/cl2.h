@@ -25,6 +25,10 @@
 #include "compiler/clifunction.h"
 #include "compiler/cliinstruction.h"
 #include "compiler/cllexer.h"
+#include "compiler/clscriptlibrary.h"
+#include "compiler/cltranslator.h"
+#include "serialize/clcompression.h"
+#include "serialize/clrecordstore.h"
 #include "serialize/clserializer.h"
 #include "serialize/clserialloader.h"
 #include "serialize/clserialsaver.h"
@@ -38,10 +42,14 @@
 #include "value/cluserdata.h"
 #include "value/clvalue.h"
 #include "vm/clcontext.h"
+#include "vm/clfuture.h"
+#include "vm/cljit.h"
 #include "vm/clmathmodule.h"
 #include "vm/clmodule.h"
+#include "vm/clnativemodule.h"
 #include "vm/clsysmodule.h"
 #include "vm/clthread.h"
+#include "vm/clworkercontext.h"
 #include "vm/clcollectable.h"
 #include "clopcode.h"
 
@@ -98,7 +98,15 @@ static CLOpcodeDesc opdesc[] =
 
 	// debug
 	{OP_FILE, "file", ARG_STRING},
-	{OP_LINE, "line", ARG_INTEGER}
+	{OP_LINE, "line", ARG_INTEGER},
+
+	// loops
+	{OP_RANGEPREP, "rangeprep", ARG_INTEGER},
+	{OP_RANGELOOP, "rangeloop", ARG_INTEGER},
+	{OP_TABLOOP, "tabloop", ARG_INTEGER},
+
+	// function call in tail position
+	{OP_TAILCALL, "tailcall", ARG_NONE}
 };
 static const int num_opdesc = sizeof(opdesc) / sizeof(CLOpcodeDesc);
 
@@ -112,3 +120,19 @@ CLOpcodeDesc getOpcodeDesc(CLOpcode op)
 	return opdesc[0];
 }
 
+bool isJumpOpcode(CLOpcode op)
+{
+	switch (op)
+	{
+		case OP_JMP:
+		case OP_JMPT:
+		case OP_JMPF:
+		case OP_JMP0:
+		case OP_RANGEPREP:
+		case OP_RANGELOOP:
+		case OP_TABLOOP:
+			return true;
+		default:
+			return false;
+	}
+}
@@ -96,9 +96,19 @@ enum CLOpcode
 	OP_JMP0,        // condition              |                              | <i> new instruction pointer (if condition is null)
 
 	OP_FILE,        //                        |                              | <s> file name
-	OP_LINE         //                        |                              | <i> line number
+	OP_LINE,        //                        |                              | <i> line number
+
+	// loops (appended to keep the numbering of saved bytecode)
+	OP_RANGEPREP,   // counter,limit          | counter,limit                | <i> loop exit (jump if counter >= limit)
+	OP_RANGELOOP,   // counter,limit          | ++counter,limit              | <i> loop body (jump if ++counter < limit)
+	OP_TABLOOP,     // table,iterator         | table,++iterator,value,key   | <i> loop body (jump unless iterator is null; no push then)
+
+	OP_TAILCALL     //func,self,arg[1..n],argc| (returns function result)    | // reuses the current frame
 };
 
+// (not an enumerator, so switches over all opcodes stay complete)
+static const int NUM_OPCODES = OP_TAILCALL + 1;
+
 enum CLArgType
 {
 	ARG_NONE,
@@ -115,6 +125,7 @@ struct CLOpcodeDesc
 };
 
 extern CLOpcodeDesc getOpcodeDesc(CLOpcode op);
+extern bool isJumpOpcode(CLOpcode op); // instruction with jump target as argument
 
 #endif
 
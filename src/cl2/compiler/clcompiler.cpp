@@ -22,6 +22,7 @@
 #include "cllexer.h"
 #include "clifunction.h"
 #include "cliinstruction.h"
+#include "clscriptlibrary.h"
 
 #include "../vm/clcontext.h"
 
@@ -35,7 +36,7 @@
 //using namespace std;
 
 CLCompiler::CLCompiler(CLContext *context, CLLexer &lexer) 
-	: context(context), lexer(lexer), last_lineop(-1), l(TOK_ERROR), fp(nullptr), stack_usage(0)
+	: context(context), lexer(lexer), last_lineop(-1), l(TOK_ERROR), peeked(TOK_ERROR), has_peeked(false), fp(nullptr), stack_usage(0)
 { 
 	is_in_root_env = false;
 }
@@ -54,7 +55,10 @@ CLValue CLCompiler::compile(CLContext *context, const std::string &path)
 	std::ifstream input(path.c_str());
 	CLLexer lexer(input, path);
 	CLCompiler comp(context, lexer);
-	return comp.compile();
+
+	CLValue mainfunc = comp.compile();
+	CLScriptLibrary::install(mainfunc, path);
+	return mainfunc;
 }
 
 void CLCompiler::error(const char *type, const char *s, ...)
@@ -84,13 +88,30 @@ void CLCompiler::expect(CLToken tok)
 
 void CLCompiler::lex()
 {
-	l = lexer.lex();
+	if (has_peeked)
+	{
+		l = peeked;
+		has_peeked = false;
+	} else {
+		l = lexer.lex();
+	}
+
 	if (l.tok == TOK_ERROR)
 	{
 		error("syntax", l.str.c_str());
 	}
 }
 
+const CLLexeme &CLCompiler::peek()
+{
+	if (!has_peeked)
+	{
+		peeked = lexer.lex();
+		has_peeked = true;
+	}
+	return peeked;
+}
+
 void CLCompiler::addLineOp(int line)
 {
 	int l = (line != -1)? line : lexer.getLine();
@@ -169,6 +190,9 @@ void CLCompiler::statement()
 			}
 			expect(CLToken(')'));
 
+			// return (f(..))? => reuse current frame for f, no need to clear locals
+			if (fp->makeTailCall()) break;
+
 			// clear local variables....
 			int in_scope = fp->getLocalsInScope();
 			if (in_scope) fp->addInstruction(new CLIInstruction(OP_DELL, in_scope));
@@ -274,13 +298,10 @@ CLIFunction *CLCompiler::compileFunction(bool root)
 	bool old_is_in_root_env = is_in_root_env;
 	is_in_root_env = root;
 
-#ifdef DEBUG
-	if (stack_usage != 0)
-	{
-		std::cout << "Internal compiler error!!!" << std::endl;
-		assert(stack_usage == 0);
-	}
-#endif
+	// function expressions inside loops/switches: their return statements must not
+	// clean up the enclosing function's stack
+	int old_stack_usage = stack_usage;
+	stack_usage = 0;
 
 	// add debug info
 	addFileOp(lexer.getFile());
@@ -319,6 +340,7 @@ CLIFunction *CLCompiler::compileFunction(bool root)
 
 	fp = old_fp;
 	is_in_root_env = old_is_in_root_env;
+	stack_usage = old_stack_usage;
 
 	return new_fp;
 }
@@ -379,39 +401,42 @@ void CLCompiler::forStatement()
 {
 	// for (a; b; c) d;
 	//
+	// The loop is rotated, so each iteration only executes one jump:
+	//
 	//             expr a
 	//             pop 1
-	// loop_start: nop                      = loop_start
-	//             expr b
-	//             jmpf loop_exit           = loop_jump_toexit
-	//             jmp loop_begin           = loop_jump_tobegin
-	// loop_incr:  nop                      = loop_incr
-	//             expr c
-	//             pop 1
-        //             jmp loop_start           = loop_jump_tostart
+	//             jmp loop_test            = loop_jump_totest
 	// loop_begin: nop                      = loop_begin
 	//             stmt d
-	//             jmp loop_incr            = loop_jump_toincr
+	//             expr c
+	//             pop 1
+	// loop_test:  nop                      = loop_test
+	//             expr b
+	//             jmpt loop_begin          = loop_jump_tobegin   (jmp loop_begin without b)
 	// loop_exit:  nop                      = loop_exit
-
-	CLIInstruction *loop_start = new CLIInstruction(OP_NOP);
-	CLIInstruction *loop_jump_toexit = new CLIInstruction(OP_JMPF, -1);
-	CLIInstruction *loop_jump_tobegin = new CLIInstruction(OP_JMP, -1);
-	CLIInstruction *loop_incr = new CLIInstruction(OP_NOP);
-	CLIInstruction *loop_jump_tostart = new CLIInstruction(OP_JMP, -1);
-	CLIInstruction *loop_begin = new CLIInstruction(OP_NOP);
-	CLIInstruction *loop_jump_toincr = new CLIInstruction(OP_JMP, -1);
-	CLIInstruction *loop_exit = new CLIInstruction(OP_NOP);
-
-	loop_jump_toexit->jump_target = loop_exit;
-	loop_jump_tobegin->jump_target = loop_begin;
-	loop_jump_tostart->jump_target = loop_start;
-	loop_jump_toincr->jump_target = loop_incr;
+	//
+	// b and c are parsed before d, so their code is moved behind d afterwards. They start
+	// with their own line ops, or they would report the last line of d.
 
 	// for (
 	expect(TOK_FOR);
 	expect(CLToken('('));
 
+	// for (i in a..b)?
+	if ((l.tok == TOK_IDENTIFIER) && (peek().tok == TOK_IN))
+	{
+		forRangeStatement();
+		return;
+	}
+
+	CLIInstruction *loop_jump_totest = new CLIInstruction(OP_JMP, -1);
+	CLIInstruction *loop_begin = new CLIInstruction(OP_NOP);
+	CLIInstruction *loop_test = new CLIInstruction(OP_NOP);
+	CLIInstruction *loop_jump_tobegin = 0;
+	CLIInstruction *loop_exit = new CLIInstruction(OP_NOP);
+
+	loop_jump_totest->jump_target = loop_test;
+
 	// initializer expression
 	if (l.tok != ';') 
 	{
@@ -420,33 +445,94 @@ void CLCompiler::forStatement()
 	}
 	expect(CLToken(';'));
 
-	fp->addInstruction(loop_start);
+	fp->addInstruction(loop_jump_totest);
 
 	// loop condition
+	size_t test_begin = fp->getCodeSize();
+	fp->addInstruction(loop_test);
 	if (l.tok != ';')
 	{
+		last_lineop = -1;
+		addLineOp();
 		expressionExpr(); // expr b
-		fp->addInstruction(loop_jump_toexit);
-	} 
+		loop_jump_tobegin = new CLIInstruction(OP_JMPT, -1);
+	} else {
+		loop_jump_tobegin = new CLIInstruction(OP_JMP, -1);
+	}
+	loop_jump_tobegin->jump_target = loop_begin;
+	fp->addInstruction(loop_jump_tobegin);
 	expect(CLToken(';'));
+	size_t test_end = fp->getCodeSize();
 
-	fp->addInstruction(loop_jump_tobegin);
-	fp->addInstruction(loop_incr);
-	
 	// loop increment expression
 	if (l.tok != ')')
 	{
+		last_lineop = -1;
+		addLineOp();
 		expressionExpr(); // expr c
 		fp->addInstruction(new CLIInstruction(OP_POP, 1));
 	}
 	expect(CLToken(')'));
+	size_t incr_end = fp->getCodeSize();
 
-	fp->addInstruction(loop_jump_tostart);
 	fp->addInstruction(loop_begin);
 	fp->beginBlock(loop_exit);
 	statement();
 	fp->endBlock();
-	fp->addInstruction(loop_jump_toincr);
+
+	// move increment & test behind the loop body
+	fp->moveCodeToEnd(test_end, incr_end);
+	fp->moveCodeToEnd(test_begin, test_end);
+	fp->addInstruction(loop_exit);
+	last_lineop = -1; // (the test ran last)
+}
+
+void CLCompiler::forRangeStatement()
+{
+	// for (i in a..b) c;                   i: local variable, counts from a up to (excluding) b
+	//
+	//             expr a                   (counter)
+	//             expr b                   (limit)
+	//             rangeprep loop_exit      = loop_jump_toexit
+	// loop_begin: dup 1                    = loop_begin
+	//             popl #i
+	//             stmt c
+	//             rangeloop loop_begin     = loop_jump_tobegin
+	// loop_exit:  pop 2                    = loop_exit
+	//
+	// (with 'for (' already accepted). Assigning to i inside the loop doesn't change
+	// the number of iterations.
+
+	CLIInstruction *loop_jump_toexit = new CLIInstruction(OP_RANGEPREP, -1);
+	CLIInstruction *loop_begin = new CLIInstruction(OP_DUP, 1);
+	CLIInstruction *loop_jump_tobegin = new CLIInstruction(OP_RANGELOOP, -1);
+	CLIInstruction *loop_exit = new CLIInstruction(OP_POP, 2);
+	loop_jump_toexit->jump_target = loop_exit;
+	loop_jump_tobegin->jump_target = loop_begin;
+
+	int local_id = fp->getLocal(l.str);
+	if (local_id < 0) error("parse", "Expected local variable identifier in for(.. in ..)");
+	lex();
+
+	// 'in' <expr> '..' <expr> ')'
+	expect(TOK_IN);
+	addLineOp();
+	expressionExpr();
+	expect(TOK_DOTDOT);
+	expressionExpr();
+	expect(CLToken(')'));
+
+	fp->addInstruction(loop_jump_toexit);
+	fp->addInstruction(loop_begin);
+	fp->addInstruction(new CLIInstruction(OP_POPL, local_id));
+
+	stack_usage += 2;
+		fp->beginBlock(loop_exit);
+		statement();
+		fp->endBlock();
+	stack_usage -= 2;
+
+	fp->addInstruction(loop_jump_tobegin);
 	fp->addInstruction(loop_exit);
 }
 
@@ -456,21 +542,18 @@ void CLCompiler::foreachStatement()
 	//
 	//             <expr>
 	//             tabit
-	// loop_start: dup 0              = loop_start
-	//             jmp0 exit          = loop_jmp_to_exit
-	//             tabnext
-	//             popl #key     or     pop 1
+	//             jmp loop_test      = loop_jmp_to_test
+	// loop_begin: popl #key     or     pop 1    = loop_begin
 	//             popl #value
 	//             <stmt>
-	//             jmp loop_start     = loop_jmp_to_start
+	// loop_test:  tabloop loop_begin = loop_test
 	// loop_exit:  pop 2              = loop_exit
 
-	CLIInstruction *loop_start        = new CLIInstruction(OP_DUP, 0);
-	CLIInstruction *loop_jmp_to_start = new CLIInstruction(OP_JMP, -1);
+	CLIInstruction *loop_jmp_to_test  = new CLIInstruction(OP_JMP, -1);
+	CLIInstruction *loop_test         = new CLIInstruction(OP_TABLOOP, -1);
 	CLIInstruction *loop_exit         = new CLIInstruction(OP_POP, 2);
-	CLIInstruction *loop_jmp_to_exit  = new CLIInstruction(OP_JMP0, -1);
-	loop_jmp_to_start->jump_target = loop_start;
-	loop_jmp_to_exit->jump_target = loop_exit;
+	CLIInstruction *loop_begin;
+	loop_jmp_to_test->jump_target = loop_test;
 
 	// foreach (
 	expect(TOK_FOREACH);
@@ -508,14 +591,13 @@ void CLCompiler::foreachStatement()
 	expect(CLToken(')'));
 	
 	fp->addInstruction(new CLIInstruction(OP_TABIT));
-	fp->addInstruction(loop_start);
-	fp->addInstruction(loop_jmp_to_exit);
-	fp->addInstruction(new CLIInstruction(OP_TABNEXT));
+	fp->addInstruction(loop_jmp_to_test);
 	if (use_key)
-		fp->addInstruction(new CLIInstruction(OP_POPL, key_id));
+		fp->addInstruction(loop_begin = new CLIInstruction(OP_POPL, key_id));
 	else
-		fp->addInstruction(new CLIInstruction(OP_POP, 1));
+		fp->addInstruction(loop_begin = new CLIInstruction(OP_POP, 1));
 	fp->addInstruction(new CLIInstruction(OP_POPL, val_id));
+	loop_test->jump_target = loop_begin;
 	
 	stack_usage += 2;
 		fp->beginBlock(loop_exit);
@@ -523,7 +605,7 @@ void CLCompiler::foreachStatement()
 		fp->endBlock();
 	stack_usage -= 2;
 
-	fp->addInstruction(loop_jmp_to_start);
+	fp->addInstruction(loop_test);
 	fp->addInstruction(loop_exit);
 }
 
@@ -63,6 +63,7 @@ private:
 
 	void whileStatement();
 	void forStatement();
+	void forRangeStatement();
 	void foreachStatement();
 	void ifStatement();
 	void breakStatement();
@@ -106,9 +107,12 @@ private:
 	int argumentList();
 
 	void lex();	// load next lexeme into 'l'
+	const CLLexeme &peek(); // lexeme following 'l'
 	void expect(CLToken tok);
 
 	CLLexeme l;		// current unprocessed lexeme
+	CLLexeme peeked;	// lexeme following 'l', if has_peeked
+	bool has_peeked;
 	class CLIFunction *fp;	// current function
 	int stack_usage;        // current stack usage _between_ statements, so that return statements can clean the
                                 // stack accordingly before OP_RET.
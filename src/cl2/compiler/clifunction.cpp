@@ -52,6 +52,28 @@ void CLIFunction::addInstruction(CLIInstruction *iinst)
 	//cout << debugprint_instruction(*iinst) << endl;
 }
 
+void CLIFunction::moveCodeToEnd(size_t begin, size_t end)
+{
+	assert(begin <= end && end <= icode.size());
+	std::rotate(icode.begin() + begin, icode.begin() + end, icode.end());
+}
+
+bool CLIFunction::makeTailCall()
+{
+	if (icode.empty()) return false;
+
+	// file op following the call is not needed, there's no return to this function
+	if ((icode.back()->op == OP_FILE) && (icode.size() > 1) && (icode[icode.size()-2]->op == OP_MCALL))
+	{
+		delete icode.back();
+		icode.pop_back();
+	}
+
+	if (icode.back()->op != OP_MCALL) return false;
+	icode.back()->op = OP_TAILCALL;
+	return true;
+}
+
 void CLIFunction::beginBlock(CLIInstruction *break_target)
 {
 	int new_first_id = 0;
@@ -155,20 +177,15 @@ CLValue CLIFunction::generateFunction()
 		}
 
 		// resolve jump targets..
-		switch (iinst->op)
+		if (isJumpOpcode(iinst->op))
 		{
-			case OP_JMP:
-			case OP_JMPF:
-			case OP_JMPT:
-			case OP_JMP0:
-				assert(iinst->jump_target);
-				inst->arg = iinst->jump_target->ip;
-				break;
-			default: break;
+			assert(iinst->jump_target);
+			inst->arg = iinst->jump_target->ip;
 		}
 
 	}
 
+	func->link();
 	return CLValue(func);
 }
 
@@ -41,6 +41,9 @@ public:
 	CLValue generateFunction();
 
 	void addInstruction(CLIInstruction *iinst);
+	size_t getCodeSize() { return icode.size(); }
+	void moveCodeToEnd(size_t begin, size_t end); // move instructions [begin, end) behind the last one
+	bool makeTailCall(); // turn a call at the end of the code into a tail call, returns false if there's none
 
 	void beginBlock(CLIInstruction *break_target = nullptr);
 	void endBlock();
@@ -95,8 +95,13 @@ CLLexeme CLLexer::lex()
 				if (ch == ':') { next(); return(TOK_DOUBLECOLON); }
 				return(':');
 
+			case '.': // . or ..
+				next();
+				if (ch == '.') { next(); return(TOK_DOTDOT); }
+				return('.');
+
 			case '$': case '@':
-			case '.': case ',':
+			case ',':
 			case '^':
 			case '|':
 			case '&':
@@ -154,7 +159,12 @@ CLLexeme CLLexer::readNumber()
 	
 	while ((isdigit(ch) || ch == '.') && !eof)
 	{
-		if (ch == '.') isfloat = true;	
+		if (ch == '.')
+		{
+			if (input.peek() == '.') break; // range operator
+			isfloat = true;
+		}
+
 		tmpstr[bufpos++] = ch;
 		next();
 	}
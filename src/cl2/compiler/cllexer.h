@@ -61,6 +61,7 @@ enum CLToken
 	TOK_SELF,	// self
 	TOK_ROOT,	// root
 	TOK_DOUBLECOLON,// ::
+	TOK_DOTDOT,	// ..
 
 	TOK_LOCAL,	// local
 
@@ -0,0 +1,184 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "clscriptlibrary.h"
+#include "clcompiler.h"
+
+#include "../serialize/clserialloader.h"
+#include "../serialize/clserialsaver.h"
+#include "../value/clfunction.h"
+#include "../vm/clcontext.h"
+
+#include <memory>
+#include <set>
+#include <stdexcept>
+
+std::map<unsigned long long, CLScriptLibrary::Location> &CLScriptLibrary::getLocations()
+{
+	static std::map<unsigned long long, Location> locations;
+	return locations;
+}
+
+void CLScriptLibrary::collect(CLValue fn, std::vector<CLValue> &functions)
+{
+	functions.push_back(fn);
+
+	std::vector<CLValue> &constants = GET_FUNCTION(fn)->constants;
+	for (size_t i=0; i<constants.size(); ++i)
+	{
+		if (constants[i].type == CL_FUNCTION) collect(constants[i], functions);
+	}
+}
+
+void CLScriptLibrary::install(CLValue main, const std::string &path)
+{
+	std::vector<CLValue> functions;
+	collect(main, functions);
+
+	std::map<unsigned long long, Location> &locations = getLocations();
+	for (size_t i=0; i<functions.size(); ++i)
+	{
+		Location &location = locations[GET_FUNCTION(functions[i])->getHash()];
+		location.path = path;
+		location.index = i;
+	}
+}
+
+bool CLScriptLibrary::find(unsigned long long hash, Location &location)
+{
+	std::map<unsigned long long, Location> &locations = getLocations();
+	std::map<unsigned long long, Location>::iterator it = locations.find(hash);
+	if (it == locations.end()) return false;
+
+	location = it->second;
+	return true;
+}
+
+std::vector<std::string> CLScriptLibrary::getPaths()
+{
+	std::set<std::string> paths;
+	std::map<unsigned long long, Location> &locations = getLocations();
+	std::map<unsigned long long, Location>::iterator it = locations.begin(), end = locations.end();
+	for (; it!=end; ++it) paths.insert(it->second.path);
+
+	return std::vector<std::string>(paths.begin(), paths.end());
+}
+
+void CLScriptLibrary::save(CLSerialSaver &S)
+{
+	std::map<unsigned long long, Location> &locations = getLocations();
+	unsigned int size = locations.size(); S.IO(size);
+
+	std::map<unsigned long long, Location>::iterator it = locations.begin(), end = locations.end();
+	for (; it!=end; ++it)
+	{
+		unsigned int hash_lo = (unsigned int)it->first, hash_hi = (unsigned int)(it->first >> 32);
+		S.IO(hash_lo);
+		S.IO(hash_hi);
+		S.IO(it->second.path);
+		S.IO(it->second.index);
+	}
+}
+
+void CLScriptLibrary::load(CLSerialLoader &S)
+{
+	std::map<unsigned long long, Location> &locations = getLocations();
+	unsigned int size; S.IO(size);
+
+	for (unsigned int i=0; i<size; ++i)
+	{
+		unsigned int hash_lo, hash_hi;
+		S.IO(hash_lo);
+		S.IO(hash_hi);
+
+		Location &location = locations[((unsigned long long)hash_hi << 32) | hash_lo];
+		S.IO(location.path);
+		S.IO(location.index);
+	}
+}
+
+CLValue CLScriptLibrary::resolve(CLContext *context, unsigned long long hash, const Location &saved, Cache &cache)
+{
+	// where the function is now, scripts compiled since the game was saved may have moved it
+	Location location = saved;
+	find(hash, location);
+
+	Cache::iterator it = cache.find(location.path);
+	if (it == cache.end())
+	{
+		std::vector<CLValue> functions;
+		collect(CLCompiler::compile(context, location.path), functions);
+		it = cache.insert(std::make_pair(location.path, functions)).first;
+	}
+
+	std::vector<CLValue> &functions = it->second;
+	if ((location.index >= 0) && ((size_t)location.index < functions.size()) && (GET_FUNCTION(functions[location.index])->getHash() == hash))
+	{
+		return functions[location.index];
+	}
+
+	// the file was edited, the function may still be there
+	for (size_t i=0; i<functions.size(); ++i)
+	{
+		if (GET_FUNCTION(functions[i])->getHash() == hash) return functions[i];
+	}
+
+	throw std::runtime_error("Script function from " + location.path + " no longer exists");
+}
+
+void CLScriptLibrary::check(CLSerialLoader &S)
+{
+	std::unique_ptr<CLContext> scratch; // created for the first file that has to be compiled
+	Cache cache;
+
+	std::shared_ptr<CLRecordStore> store = S.getRecordStore();
+	std::vector<unsigned int> ids = store->getIds();
+	for (size_t i=0; i<ids.size(); ++i)
+	{
+		if (S.recordType(ids[i]) != CL_RAW_FUNCTION) continue;
+
+		// (see CLFunction::save)
+		int type;
+		bool ref;
+		unsigned int hash_lo = 0, hash_hi = 0;
+		Location location;
+		S.pushInput(*store->find(ids[i]));
+		S.IO(type);
+		S.IO(ref);
+		if (ref)
+		{
+			S.IO(hash_lo);
+			S.IO(hash_hi);
+			S.IO(location.path);
+			S.IO(location.index);
+		}
+		S.popInput();
+
+		if (!ref) continue;
+
+		// registered: resolve compiles the file once while loading
+		unsigned long long hash = ((unsigned long long)hash_hi << 32) | hash_lo;
+		Location registered;
+		if (find(hash, registered)) continue;
+
+		if (!scratch) scratch.reset(new CLContext());
+		resolve(scratch.get(), hash, location, cache);
+	}
+}
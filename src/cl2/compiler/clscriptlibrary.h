@@ -0,0 +1,69 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef CLSCRIPTLIBRARY_H
+#define CLSCRIPTLIBRARY_H
+
+#include "../value/clvalue.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Functions compiled from script files, by content hash (CLFunction::getHash). Savegames refer
+// to these by hash and location instead of storing their code (see CLSerialSaver::setFunctionRefs),
+// loading compiles the script file again.
+class CLScriptLibrary
+{
+public:
+	struct Location
+	{
+		std::string path; // script file
+		int index;        // of the function in the file, depth-first from the main function
+	};
+
+	// register the functions of a compiled script file (called by CLCompiler::compile)
+	static void install(CLValue main, const std::string &path);
+	static bool find(unsigned long long hash, Location &location);
+	static std::vector<std::string> getPaths(); // of the script files registered
+
+	// the registered functions, so a restored heap (e.g. a boot image) can refer to its script
+	// files without compiling them again
+	static void save(class CLSerialSaver &S);
+	static void load(class CLSerialLoader &S);
+
+	// The function with the given hash, compiled into the context. Each script file is compiled
+	// once per cache, so the functions of a file keep referring to each other.
+	typedef std::map<std::string, std::vector<CLValue> > Cache;
+	static CLValue resolve(class CLContext *context, unsigned long long hash, const Location &saved, Cache &cache);
+
+	// Throws like resolve if a function record read by the loader (see CLContext::loadRecords)
+	// can't be resolved, before loading destroys anything. Functions registered already pass
+	// by hash, only script files that haven't been compiled yet are compiled (into a scratch
+	// context).
+	static void check(class CLSerialLoader &S);
+
+private:
+	static void collect(CLValue fn, std::vector<CLValue> &functions);
+	static std::map<unsigned long long, Location> &getLocations();
+};
+
+#endif
+
@@ -0,0 +1,195 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "cltranslator.h"
+
+#include "../value/clfunction.h"
+#include "../vm/clnativeops.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+using namespace std;
+
+static std::string functionName(unsigned long long hash)
+{
+	char buf[32];
+	sprintf(buf, "f_%016llx", hash);
+	return buf;
+}
+
+static std::string hashLiteral(unsigned long long hash)
+{
+	char buf[32];
+	sprintf(buf, "0x%016llxULL", hash);
+	return buf;
+}
+
+// call of the inline form of a plain instruction (see CLNativeOps), empty if there's none
+static std::string inlineCall(const CLInstruction &inst)
+{
+	switch (inst.op)
+	{
+		case OP_PUSHI: return "O::pushi_n(t, " + std::to_string(inst.arg) + ")";
+		case OP_PUSHB: return std::string("O::pushb_n(t, ") + (inst.arg == 0 ? "false" : "true") + ")";
+		case OP_POP:   return "O::pop_n(t, " + std::to_string(inst.arg) + ")";
+		case OP_DUP:   return "O::dup_n(t, " + std::to_string(inst.arg) + ")";
+		case OP_PUSHL: return "O::pushl_n(t, " + std::to_string(inst.arg) + ")";
+		case OP_POPL:  return "O::popl_n(t, " + std::to_string(inst.arg) + ")";
+		case OP_ADD:   return "O::add_int(t)";
+		case OP_SUB:   return "O::sub_int(t)";
+		case OP_MUL:   return "O::mul_int(t)";
+		case OP_LT:    return "O::lt_int(t)";
+		case OP_GT:    return "O::gt_int(t)";
+		case OP_LE:    return "O::le_int(t)";
+		case OP_GE:    return "O::ge_int(t)";
+		default:       return "";
+	}
+}
+
+CLTranslator::CLTranslator(const std::string &module_name) : module_name(module_name)
+{
+}
+
+bool CLTranslator::contains(unsigned long long hash)
+{
+	for (size_t i=0; i<functions.size(); ++i)
+	{
+		if (GET_FUNCTION(functions[i])->getHash() == hash) return true;
+	}
+	return false;
+}
+
+void CLTranslator::add(CLValue func)
+{
+	if (func.type != CL_FUNCTION) throw std::runtime_error("CLTranslator: not a function");
+
+	CLFunction *fn = GET_FUNCTION(func);
+	if (contains(fn->getHash())) return; // same code added before
+
+	// nested functions first
+	size_t size = fn->constants.size();
+	for (size_t i=0; i<size; ++i)
+	{
+		if (fn->constants[i].type == CL_FUNCTION) add(fn->constants[i]);
+	}
+
+	functions.push_back(func);
+}
+
+void CLTranslator::write(std::ostream &out)
+{
+	out << "// Native code of CL2 script functions, generated by CLTranslator. Do not edit." << endl;
+	out << endl;
+	out << "#include \"cl2/vm/clnativeops.h\"" << endl;
+	out << "#include \"cl2/vm/clnativemodule.h\"" << endl;
+	out << endl;
+	out << "typedef CLNativeOps O;" << endl;
+	out << endl;
+
+	for (size_t i=0; i<functions.size(); ++i) writeFunction(out, GET_FUNCTION(functions[i]));
+
+	out << "static const CLNativeModule::Entry entries[] =" << endl;
+	out << "{" << endl;
+	for (size_t i=0; i<functions.size(); ++i)
+	{
+		unsigned long long hash = GET_FUNCTION(functions[i])->getHash();
+		out << "\t{" << hashLiteral(hash) << ", &" << functionName(hash) << "}";
+		out << (i+1 < functions.size() ? "," : "") << endl;
+	}
+	out << "};" << endl;
+	out << endl;
+	out << "static CLNativeModule module(\"" << module_name << "\", entries, sizeof(entries) / sizeof(CLNativeModule::Entry));" << endl;
+}
+
+void CLTranslator::writeFunction(std::ostream &out, CLFunction *fn)
+{
+	size_t n = fn->code.size();
+
+	out << "static int " << functionName(fn->getHash()) << "(CLThread *t)" << endl;
+	out << "{" << endl;
+	out << "\tCLFunction *fn = O::function(t);" << endl;
+	out << "\tCLInstruction *code = &fn->code[0];" << endl;
+	out << "\tint r;" << endl;
+	out << endl;
+
+	// resume at current instruction
+	out << "\tswitch (O::ip(t))" << endl;
+	out << "\t{" << endl;
+	for (size_t i=0; i<n; ++i) out << "\t\tcase " << i << ": goto L" << i << ";" << endl;
+	out << "\t}" << endl;
+	out << "\treturn CLJit::REDISPATCH;" << endl;
+	out << endl;
+
+	for (size_t i=0; i<n; ++i)
+	{
+		CLInstruction &inst = fn->code[i];
+		const CLNativeOpDesc *desc = getNativeOpDesc(inst.op);
+		if (!desc) throw std::runtime_error(std::string("CLTranslator: no native implementation of ") + getOpcodeDesc(inst.op).name);
+
+		std::string arg;
+		{
+			char buf[64];
+			if (inst.op == OP_PUSHCONST) sprintf(buf, "&fn->constants[%d]", inst.arg);
+			else sprintf(buf, "&code[%u]", unsigned(i));
+			arg = buf;
+		}
+		std::string call = std::string("O::") + (desc->name ? desc->name : "") + "(t, " + arg + ")";
+
+		out << "L" << i << ":\t";
+		switch (desc->kind)
+		{
+			case NATIVE_NONE:
+				out << ";";
+				break;
+
+			case NATIVE_PLAIN:
+			{
+				std::string inline_call = inlineCall(inst);
+				out << (inline_call.empty() ? call : inline_call) << ";";
+				break;
+			}
+
+			case NATIVE_EXIT:
+				out << "if ((r = " << call << ") != 0) return r;";
+				break;
+
+			case NATIVE_BRANCH:
+			case NATIVE_JUMP:
+			{
+				if ((inst.arg < 0) || (size_t(inst.arg) >= n)) throw std::runtime_error("CLTranslator: invalid jump target");
+
+				// backward jumps check the timeout
+				std::string jump = "goto L" + std::to_string(inst.arg) + ";";
+				if (size_t(inst.arg) <= i)
+					jump = "{ if ((r = O::backedge(t, &code[" + std::to_string(inst.arg) + "])) != 0) return r; " + jump + " }";
+
+				if (desc->kind == NATIVE_BRANCH) out << "if (" << call << ") " << jump;
+				else out << jump;
+				break;
+			}
+		}
+		out << endl;
+	}
+
+	out << "\treturn CLJit::REDISPATCH; // not reached" << endl;
+	out << "}" << endl;
+	out << endl;
+}
@@ -0,0 +1,59 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef CLTRANSLATOR_H
+#define CLTRANSLATOR_H
+
+#include "../value/clvalue.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+class CLFunction;
+
+// Translates compiled script functions to the C++ source of a CLNativeModule.
+// Each function becomes a state machine over its instructions that is entered
+// at the instruction pointer of the current frame, so yields and calls work as
+// in the interpreter. Linked into the application, the native code replaces
+// any script function with the same content (see CLFunction::getHash()); if a
+// script is changed, its bytecode is run again.
+// Instructions are calls of the CLNativeOps helpers, which the C++ compiler
+// inlines. Pushes, pops and locals get their argument as a constant, and integer
+// arithmetic and comparisons have a fast path; everything else (table access,
+// calls, other operators) does just what the interpreter does, so the gain is
+// the dispatch, not the operations themselves.
+class CLTranslator
+{
+public:
+	CLTranslator(const std::string &module_name);
+
+	void add(CLValue func); // add function and all functions nested inside
+	void write(std::ostream &out);
+
+private:
+	std::string module_name;
+	std::vector<CLValue> functions;
+
+	bool contains(unsigned long long hash);
+	void writeFunction(std::ostream &out, CLFunction *fn);
+};
+
+#endif
@@ -0,0 +1,138 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "clcompression.h"
+
+#include <string.h>
+#include <zlib.h>
+
+#include <stdexcept>
+#include <vector>
+
+static void putLE(unsigned char *p, unsigned long long value, int bytes)
+{
+	for (int i=0; i<bytes; ++i) p[i] = (unsigned char)(value >> (8 * i));
+}
+
+static unsigned long long getLE(const unsigned char *p, int bytes)
+{
+	unsigned long long value = 0;
+	for (int i=0; i<bytes; ++i) value |= (unsigned long long)p[i] << (8 * i);
+	return value;
+}
+
+void CLCompression::write(std::ostream &output, const std::string &data, Codec codec, int level)
+{
+	unsigned char header[HEADER_SIZE];
+	memcpy(header, "CLZ", 3);
+	header[3] = VERSION;
+	header[4] = (unsigned char)codec;
+	putLE(header + 5, data.size(), 8);
+	putLE(header + 13, crc32(0, (const Bytef*)data.data(), data.size()), 4);
+	output.write((const char*)header, HEADER_SIZE);
+
+	switch (codec)
+	{
+		case STORE:
+			output.write(data.data(), data.size());
+			break;
+
+		case DEFLATE:
+		{
+			z_stream zs;
+			memset(&zs, 0, sizeof(zs));
+			if (deflateInit(&zs, level) != Z_OK) throw std::runtime_error("Compression failed: invalid level");
+
+			zs.next_in = (Bytef*)data.data();
+			zs.avail_in = data.size();
+
+			std::vector<char> chunk(CHUNK_SIZE);
+			int ret;
+			do
+			{
+				zs.next_out = (Bytef*)&chunk[0];
+				zs.avail_out = chunk.size();
+				ret = deflate(&zs, Z_FINISH);
+				output.write(&chunk[0], chunk.size() - zs.avail_out);
+			} while (ret == Z_OK);
+
+			deflateEnd(&zs);
+			if (ret != Z_STREAM_END) throw std::runtime_error("Compression failed");
+			break;
+		}
+
+		default:
+			throw std::runtime_error("Compression failed: unknown codec");
+	}
+}
+
+void CLCompression::read(std::istream &input, std::string &data)
+{
+	unsigned char header[HEADER_SIZE];
+	input.read((char*)header, HEADER_SIZE);
+	if (((size_t)input.gcount() != HEADER_SIZE) || (memcmp(header, "CLZ", 3) != 0)) throw std::runtime_error("Invalid data: no CLZ header");
+	if (header[3] != VERSION) throw std::runtime_error("Invalid data: unsupported CLZ version");
+
+	size_t size = getLE(header + 5, 8);
+	unsigned long crc = getLE(header + 13, 4);
+	data.resize(size);
+
+	switch (header[4])
+	{
+		case STORE:
+			if (size > 0) input.read(&data[0], size);
+			if ((size_t)input.gcount() != size) throw std::runtime_error("Invalid data: truncated");
+			break;
+
+		case DEFLATE:
+		{
+			z_stream zs;
+			memset(&zs, 0, sizeof(zs));
+			if (inflateInit(&zs) != Z_OK) throw std::runtime_error("Invalid data: inflateInit failed");
+
+			zs.next_out = (Bytef*)&data[0];
+			zs.avail_out = size;
+
+			std::vector<char> chunk(CHUNK_SIZE);
+			int ret = Z_OK;
+			while (ret == Z_OK)
+			{
+				if (zs.avail_in == 0)
+				{
+					input.read(&chunk[0], chunk.size());
+					zs.next_in = (Bytef*)&chunk[0];
+					zs.avail_in = input.gcount();
+					if (zs.avail_in == 0) break; // truncated
+				}
+				ret = inflate(&zs, Z_NO_FLUSH);
+			}
+
+			inflateEnd(&zs);
+			if ((ret != Z_STREAM_END) || (zs.total_out != size)) throw std::runtime_error("Invalid data: damaged or truncated");
+			break;
+		}
+
+		default:
+			throw std::runtime_error("Invalid data: unknown codec");
+	}
+
+	if (crc32(0, (const Bytef*)data.data(), data.size()) != crc) throw std::runtime_error("Invalid data: checksum mismatch");
+}
+
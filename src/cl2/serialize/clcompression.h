@@ -0,0 +1,51 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef CL_COMPRESSION_H
+#define CL_COMPRESSION_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+// Container for serialized data on disk (e.g. savegames):
+//   header:  "CLZ", format version, codec, size and CRC-32 of the data (little endian)
+//   payload: the data, as stored by the codec
+// The payload is compressed/decompressed in chunks straight from/to the stream.
+class CLCompression
+{
+public:
+	enum Codec
+	{
+		STORE   = 0, // uncompressed
+		DEFLATE = 1  // zlib, level -1 (default) .. 9
+	};
+
+	static void write(std::ostream &output, const std::string &data, Codec codec = DEFLATE, int level = -1);
+	static void read(std::istream &input, std::string &data); // throws std::runtime_error if data is damaged
+
+private:
+	static const unsigned char VERSION = 1;
+	static const size_t HEADER_SIZE = 17;
+	static const size_t CHUNK_SIZE = 64 * 1024;
+};
+
+#endif
+
@@ -0,0 +1,74 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "clrecordstore.h"
+
+void CLRecordStore::add(unsigned int id, std::string &data)
+{
+	records[id].swap(data);
+}
+
+void CLRecordStore::remove(unsigned int id)
+{
+	records.erase(id);
+	refs.erase(id);
+}
+
+const std::string *CLRecordStore::find(unsigned int id)
+{
+	std::unordered_map<unsigned int, std::string>::iterator it = records.find(id);
+	return (it != records.end()) ? &it->second : 0;
+}
+
+std::vector<unsigned int> CLRecordStore::getIds()
+{
+	std::vector<unsigned int> ids;
+	ids.reserve(records.size());
+	std::unordered_map<unsigned int, std::string>::iterator it = records.begin(), end = records.end();
+	for (; it!=end; ++it) ids.push_back(it->first);
+	return ids;
+}
+
+void CLRecordStore::setRefs(unsigned int id, std::vector<unsigned int> &ids)
+{
+	refs[id].swap(ids);
+}
+
+const std::vector<unsigned int> *CLRecordStore::getRefs(unsigned int id)
+{
+	std::unordered_map<unsigned int, std::vector<unsigned int> >::iterator it = refs.find(id);
+	return (it != refs.end()) ? &it->second : 0;
+}
+
+void CLRecordStore::setObject(unsigned int id, CLObject *obj)
+{
+	objects[id] = obj;
+}
+
+CLObject *CLRecordStore::getObject(unsigned int id)
+{
+	std::unordered_map<unsigned int, CLObject*>::iterator it = objects.find(id);
+	return (it != objects.end()) ? it->second : 0;
+}
+
+void CLRecordStore::removeObject(unsigned int id)
+{
+	objects.erase(id);
+}
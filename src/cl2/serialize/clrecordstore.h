@@ -0,0 +1,64 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef CL_RECORDSTORE_H
+#define CL_RECORDSTORE_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class CLObject;
+
+// Object records of a save chain (see CLSerialSaver::Mode) by save id, and the objects
+// loaded from them. A loader drops a record once its object is loaded; the store outlives
+// the loader while lazily loaded objects still need records (see CLSerialLoader::setLazy).
+// The store doesn't keep its objects alive, the context drops those it frees.
+class CLRecordStore
+{
+public:
+	CLRecordStore() : proxies(0) {}
+
+	// records
+	void add(unsigned int id, std::string &data); // takes the data, replaces an older record
+	void remove(unsigned int id);
+	const std::string *find(unsigned int id);     // 0 if there's none
+	std::vector<unsigned int> getIds();           // of the records left
+
+	// ids a record refers to that lead to loaded objects, for the GC (see CLContext::finishLoad)
+	void setRefs(unsigned int id, std::vector<unsigned int> &refs); // takes the ids
+	const std::vector<unsigned int> *getRefs(unsigned int id);      // 0 if not known
+
+	// objects
+	void setObject(unsigned int id, CLObject *obj);
+	CLObject *getObject(unsigned int id);         // 0 if not loaded yet
+	void removeObject(unsigned int id);
+	const std::unordered_map<unsigned int, CLObject*> &getObjects() { return objects; }
+
+	size_t proxies; // lazy objects still waiting for their record
+
+private:
+	std::unordered_map<unsigned int, std::string> records;
+	std::unordered_map<unsigned int, std::vector<unsigned int> > refs;
+	std::unordered_map<unsigned int, CLObject*> objects;
+};
+
+#endif
+
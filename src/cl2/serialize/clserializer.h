@@ -24,6 +24,7 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
 
 #include <assert.h>
 
@@ -32,6 +33,9 @@ class CLUserDataSerializer;
 class CLSerializer
 {
 public:
+	// format of the serialized objects and bytecode, raise it when either changes
+	static const unsigned int VERSION = 1;
+
 	CLSerializer() : userdata_serializer(0) {}
 	virtual ~CLSerializer() {}
 
@@ -45,8 +49,10 @@ public:
 
 	inline int addPtr(void *ptr)
 	{
+		int idx = ptr_stack.size();
 		ptr_stack.push_back(ptr);
-		return ptr_stack.size() - 1;
+		ptr_index[ptr] = idx;
+		return idx;
 	}
 
 	inline void *getPtr(int idx)
@@ -55,10 +61,15 @@ public:
 		return ptr_stack[idx];
 	}
 
+	inline int ptrCount()
+	{
+		return ptr_stack.size();
+	}
+
 	inline int findPtr(void *ptr)
 	{
-		for (unsigned i=0; i<ptr_stack.size(); ++i) if (ptr == ptr_stack[i]) return i;
-		return -1;
+		std::unordered_map<void*, int>::iterator it = ptr_index.find(ptr);
+		return (it != ptr_index.end()) ? it->second : -1;
 	}
 
 	void setUserDataSerializer(CLUserDataSerializer *uds) { userdata_serializer = uds; }
@@ -69,6 +80,7 @@ public:
 
 private:
 	std::vector<void*> ptr_stack;
+	std::unordered_map<void*, int> ptr_index;
 	CLUserDataSerializer *userdata_serializer;
 };
 
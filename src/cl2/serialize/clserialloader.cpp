@@ -19,15 +19,22 @@
 */
 
 #include "clserialloader.h"
+#include "../value/clobject.h"
 
 #include <assert.h>
+#include <string.h>
 
 #include <iostream>
+#include <stdexcept>
 
 using namespace std;
 
+// size of the read buffer; the stream is read in blocks of this size
+static const size_t BUFFER_SIZE = 64 * 1024;
+
 CLSerialLoader::CLSerialLoader(std::istream &input, CLContext *context)
-	: input(input), context(context)
+	: input(input), context(context), buffer(BUFFER_SIZE), pos(0), fill(0),
+	  store(std::make_shared<CLRecordStore>()), lazy(false), lazy_min_size(0)
 {
 }
 
@@ -35,24 +42,88 @@ CLSerialLoader::~CLSerialLoader()
 {
 }
 
+bool CLSerialLoader::refill()
+{
+	input.read(&buffer[0], buffer.size());
+	fill = input.gcount();
+	pos = 0;
+	return fill > 0;
+}
+
+void CLSerialLoader::get(char *data, size_t size)
+{
+	if (!sources.empty())
+	{
+		Source &src = sources.back();
+		if (size > src.size - src.pos) throw std::runtime_error("Invalid savegame: unexpected end of data");
+		memcpy(data, src.data + src.pos, size);
+		src.pos += size;
+		return;
+	}
+
+	while (size > 0)
+	{
+		if (pos == fill)
+		{
+			if (size >= buffer.size())
+			{
+				// large reads go directly to the destination
+				input.read(data, size);
+				size_t got = input.gcount();
+				if (got < size) memset(data + got, 0, size - got);
+				return;
+			}
+
+			if (!refill())
+			{
+				// premature end of input, behave like a failed stream read
+				memset(data, 0, size);
+				return;
+			}
+		}
+
+		size_t n = fill - pos;
+		if (n > size) n = size;
+		memcpy(data, &buffer[pos], n);
+		pos += n; data += n; size -= n;
+	}
+}
+
+unsigned long long CLSerialLoader::getVarint()
+{
+	unsigned long long value = 0;
+	int shift = 0;
+	char ch;
+
+	do
+	{
+		get(&ch, 1);
+		value |= (unsigned long long)(ch & 0x7F) << shift;
+		shift += 7;
+	} while ((ch & 0x80) && (shift < 64));
+
+	return value;
+}
+
 void CLSerialLoader::IO(unsigned int &value)
 {
-	input.read((char*)&value, sizeof(unsigned int));
+	value = (unsigned int)getVarint();
 }
 
 void CLSerialLoader::IO(int &value)
 {
-	input.read((char*)&value, sizeof(int));
+	unsigned int zz = (unsigned int)getVarint();
+	value = (int)(zz >> 1) ^ -(int)(zz & 1);
 }
 
 void CLSerialLoader::IO(char &value)
 {
-	input.read((char*)&value, 1);
+	get(&value, 1);
 }
 
 void CLSerialLoader::IO(float &value)
 {
-	input.read((char*)&value, sizeof(float));
+	get((char*)&value, sizeof(float));
 }
 
 void CLSerialLoader::IO(bool &value)
@@ -63,20 +134,16 @@ void CLSerialLoader::IO(bool &value)
 
 void CLSerialLoader::IO(std::string &value)
 {
-	unsigned int len = value.size();
+	unsigned int len;
 	IO(len);
 
-	value = std::string(len, ' ');
-	for (unsigned i=0; i<len; ++i) 
-	{
-		char ch; IO(ch);
-		value[i] = ch;
-	}
+	value.resize(len);
+	if (len > 0) get(&value[0], len);
 }
 
 void CLSerialLoader::IO_size_t(size_t &value)
 {
-	input.read((char*)&value, sizeof(size_t));
+	value = (size_t)getVarint();
 }
 
 void CLSerialLoader::magic(const std::string &code)
@@ -99,3 +166,99 @@ void CLSerialLoader::magic(unsigned int code)
 	}
 }
 
+void CLSerialLoader::pushInput(const std::string &data)
+{
+	Source src = { data.data(), data.size(), 0 };
+	sources.push_back(src);
+}
+
+void CLSerialLoader::popInput()
+{
+	assert(!sources.empty());
+	sources.pop_back();
+}
+
+void CLSerialLoader::readBlock(std::string &data)
+{
+	unsigned int len;
+	get((char*)&len, sizeof(len));
+
+	data.resize(len);
+	if (len > 0) get(&data[0], len);
+}
+
+void CLSerialLoader::addRecord(unsigned int id, std::string &data)
+{
+	store->add(id, data);
+}
+
+void CLSerialLoader::removeRecord(unsigned int id)
+{
+	store->remove(id);
+}
+
+bool CLSerialLoader::beginRecord(unsigned int id)
+{
+	const std::string *data = store->find(id);
+	if (!data) return false;
+
+	// the record's object is the next one added (loaders add it before they load other values)
+	record_ptrs[id] = ptrCount();
+	pushInput(*data);
+	return true;
+}
+
+void CLSerialLoader::endRecord(unsigned int id)
+{
+	popInput();
+
+	std::unordered_map<unsigned int, int>::iterator it = record_ptrs.find(id);
+	store->setObject(id, (CLObject*)getPtr(it->second));
+	record_ptrs.erase(it);
+	store->remove(id);
+}
+
+CLObject *CLSerialLoader::findRecord(unsigned int id)
+{
+	CLObject *obj = store->getObject(id);
+	if (obj) return obj;
+
+	std::unordered_map<unsigned int, int>::iterator it = record_ptrs.find(id); // (still being loaded)
+	return (it != record_ptrs.end()) ? (CLObject*)getPtr(it->second) : 0;
+}
+
+int CLSerialLoader::recordType(unsigned int id)
+{
+	const std::string *data = store->find(id);
+	if (!data) return -1;
+
+	int type;
+	pushInput(*data);
+	IO(type);
+	popInput();
+	return type;
+}
+
+void CLSerialLoader::setLazy(bool lazy, size_t min_size)
+{
+	this->lazy = lazy;
+	lazy_min_size = min_size;
+}
+
+bool CLSerialLoader::isLazyRecord(unsigned int id)
+{
+	if (!lazy) return false;
+
+	const std::string *data = store->find(id);
+	if (!data || (data->size() < lazy_min_size)) return false;
+
+	int type = recordType(id);
+	return (type == CL_RAW_TABLE) || (type == CL_RAW_ARRAY);
+}
+
+void CLSerialLoader::addProxy(unsigned int id, CLObject *obj)
+{
+	store->setObject(id, obj);
+	++store->proxies;
+}
+
@@ -22,9 +22,15 @@
 #ifndef CL_SERIALLOADER_H
 #define CL_SERIALLOADER_H
 
+#include "clrecordstore.h"
 #include "clserializer.h"
+#include "../value/clvalue.h"
 
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
+#include <unordered_map>
 #include <istream>
 
 class CLSerialLoader : public CLSerializer
@@ -46,9 +52,57 @@ public:
 
 	class CLContext *getContext() { return context; }
 
+	// read from data instead of the stream until popInput (data must stay around until then)
+	void pushInput(const std::string &data);
+	void popInput();
+
+	// record modes (see CLSerialSaver::Mode)
+	void readBlock(std::string &data);
+	void addRecord(unsigned int id, std::string &data); // takes the data, replaces an older record
+	void removeRecord(unsigned int id);
+	bool beginRecord(unsigned int id); // read from the record until endRecord, false if there's none
+	void endRecord(unsigned int id);
+	CLObject *findRecord(unsigned int id); // a record's object, 0 if not loaded yet
+	int recordType(unsigned int id);       // CL_RAW_* type of a record's object, -1 if there's none
+
+	// Lazy loading: records of tables and arrays of at least min_size bytes aren't loaded
+	// when they're referred to. The loader creates an empty proxy object instead (addProxy),
+	// which is loaded in place on first access (see CLContext::materialize).
+	static const size_t LAZY_MIN_SIZE = 4096;
+	void setLazy(bool lazy, size_t min_size = LAZY_MIN_SIZE);
+	bool isLazyRecord(unsigned int id);
+	void addProxy(unsigned int id, CLObject *obj);
+
+	std::shared_ptr<CLRecordStore> getRecordStore() { return store; }
+	void setRecordStore(std::shared_ptr<CLRecordStore> store) { this->store = store; }
+
+	// script files compiled for function references (see CLScriptLibrary::resolve)
+	std::map<std::string, std::vector<CLValue> > &getScriptCache() { return script_cache; }
+
 private:
+	void get(char *data, size_t size);
+	unsigned long long getVarint();
+	bool refill();
+
 	std::istream &input;
 	class CLContext *context;
+
+	std::vector<char> buffer;
+	size_t pos, fill;
+
+	struct Source
+	{
+		const char *data;
+		size_t size, pos;
+	};
+	std::vector<Source> sources; // pushed inputs
+
+	std::shared_ptr<CLRecordStore> store;
+	std::unordered_map<unsigned int, int> record_ptrs; // pointer indices of records being loaded
+	bool lazy;
+	size_t lazy_min_size;
+
+	std::map<std::string, std::vector<CLValue> > script_cache;
 };
 
 #endif
@@ -21,33 +21,95 @@
 
 #include "clserialsaver.h"
 
+#include <assert.h>
+#include <string.h>
+
+#include <algorithm>
+
+// size of the write buffer; data is handed to the stream in blocks of this size
+static const size_t BUFFER_SIZE = 64 * 1024;
+
 CLSerialSaver::CLSerialSaver(std::ostream &output)
-	: output(output)
+	: output(output), buffer(BUFFER_SIZE), fill(0), open_blocks(0), outer_block(0), mode(INLINE), function_refs(false)
 {
 }
 
 CLSerialSaver::~CLSerialSaver()
 {
+	if (open_blocks > 0) fill = outer_block;
+	flush();
+}
+
+void CLSerialSaver::finish()
+{
+	assert(open_blocks == 0);
+	flush();
+}
+
+void CLSerialSaver::flush()
+{
+	if (fill > 0) output.write(&buffer[0], fill);
+	fill = 0;
+}
+
+void CLSerialSaver::put(const char *data, size_t size)
+{
+	if ((fill + size > buffer.size()) && (open_blocks > 0))
+	{
+		// keep the open blocks in the buffer until their length is known
+		buffer.resize(std::max(buffer.size() * 2, fill + size));
+	}
+	else if (fill + size > buffer.size())
+	{
+		flush();
+		if (size > buffer.size())
+		{
+			// too large to be buffered, bypass the buffer
+			output.write(data, size);
+			return;
+		}
+	}
+
+	memcpy(&buffer[fill], data, size);
+	fill += size;
+}
+
+// integers are written as LEB128 varints, 7 bits per byte, low bits first
+void CLSerialSaver::putVarint(unsigned long long value)
+{
+	char tmp[10];
+	size_t n = 0;
+
+	while (value >= 0x80)
+	{
+		tmp[n++] = (char)((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+	tmp[n++] = (char)value;
+
+	put(tmp, n);
 }
 
 void CLSerialSaver::IO(unsigned int &value)
 {
-	output.write((char*)&value, sizeof(unsigned int));
+	putVarint(value);
 }
 
 void CLSerialSaver::IO(int &value)
 {
-	output.write((char*)&value, sizeof(int));
+	// zigzag encoding keeps small negative numbers short
+	unsigned int zz = ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+	putVarint(zz);
 }
 
 void CLSerialSaver::IO(char &value)
 {
-	output.write((char*)&value, 1);
+	put(&value, 1);
 }
 
 void CLSerialSaver::IO(float &value)
 {
-	output.write((char*)&value, sizeof(float));
+	put((char*)&value, sizeof(float));
 }
 
 void CLSerialSaver::IO(bool &value)
@@ -58,19 +120,14 @@ void CLSerialSaver::IO(bool &value)
 
 void CLSerialSaver::IO_size_t(size_t &value)
 {
-	output.write((char*)&value, sizeof(size_t));
+	putVarint(value);
 }
 
 void CLSerialSaver::IO(std::string &value)
 {
 	unsigned int len = value.size();
 	IO(len);
-
-	for (unsigned i=0; i<len; ++i) 
-	{
-		char ch = value[i];
-		IO(ch);
-	}
+	put(value.data(), len);
 }
 
 void CLSerialSaver::magic(const std::string &code)
@@ -84,3 +141,29 @@ void CLSerialSaver::magic(unsigned int code)
 	IO(code);
 }
 
+bool CLSerialSaver::nextRecord(CLValue &value)
+{
+	if (queue.empty()) return false;
+	value = queue.front();
+	queue.pop_front();
+	return true;
+}
+
+size_t CLSerialSaver::beginBlock()
+{
+	size_t start = fill;
+	if (open_blocks++ == 0) outer_block = start;
+
+	unsigned int len = 0;
+	put((char*)&len, sizeof(len));
+	return start;
+}
+
+void CLSerialSaver::endBlock(size_t start)
+{
+	assert(open_blocks > 0);
+	unsigned int len = fill - start - sizeof(len);
+	memcpy(&buffer[start], &len, sizeof(len));
+	--open_blocks;
+}
+
@@ -23,8 +23,11 @@
 #define CL_SERIALSAVER_H
 
 #include "clserializer.h"
+#include "../value/clvalue.h"
 
+#include <deque>
 #include <string>
+#include <vector>
 #include <ostream>
 
 class CLSerialSaver : public CLSerializer
@@ -44,8 +47,44 @@ public:
 	void magic(const std::string &code);
 	void magic(unsigned int code);
 
+	// writes all buffered data to the output stream, all blocks must be ended. Also done on
+	// destruction, where blocks still open (unwinding from an error) are dropped
+	void finish();
+
+	// Record modes, for delta savegames: objects aren't written inline where they're referenced.
+	// Values refer to them by a save id and each object is written once, as a record (see
+	// CLContext::saveRecords). A FULL save starts a new chain of saves, a DELTA only writes
+	// the objects which are new or changed since the previous save of the chain.
+	enum Mode { INLINE, FULL, DELTA };
+	void setMode(Mode mode) { this->mode = mode; }
+	Mode getMode() { return mode; }
+
+	// objects waiting to be written as records
+	void queueRecord(CLValue value) { queue.push_back(value); }
+	bool nextRecord(CLValue &value);
+
+	// length prefixed block of data, the length is filled in by endBlock
+	size_t beginBlock();
+	void endBlock(size_t start);
+
+	// write functions compiled from script files as references (see CLScriptLibrary)
+	void setFunctionRefs(bool refs) { function_refs = refs; }
+	bool getFunctionRefs() { return function_refs; }
+
 private:
+	void put(const char *data, size_t size);
+	void putVarint(unsigned long long value);
+	void flush(); // write the buffer
+
 	std::ostream &output;
+	std::vector<char> buffer;
+	size_t fill;
+	int open_blocks; // the buffer isn't flushed while blocks are open
+	size_t outer_block; // start of the outermost open block
+
+	Mode mode;
+	std::deque<CLValue> queue;
+	bool function_refs;
 };
 
 #endif
@@ -35,15 +35,27 @@ int main(int argc, char **args)
 		CLContext context;
 		
 		const char *file = argc > 1 ? args[1] : 0;
-		if (file == 0)
+		if (file == 0 || (argc > 2 && (argc < 4 || string(args[2]) != "-cpp")))
 		{
-			cout << "Syntax: " << args[0] << " scriptfile" << endl;
+			cout << "Syntax: " << args[0] << " scriptfile [-cpp outfile [modulename]]" << endl;
 			exit(-2);
 		}
 
 		cout << "Checking script " << file << endl;
 		CLValue mainfunc = CLCompiler::compile(&context, file);
 
+		// translate to native module?
+		if (argc > 3)
+		{
+			CLTranslator translator(argc > 4 ? args[4] : "native");
+			translator.add(mainfunc);
+
+			ofstream out(args[3]);
+			translator.write(out);
+			if (!out) throw std::runtime_error(string("Can't write ") + args[3]);
+			cout << "Wrote native module to " << args[3] << endl;
+		}
+
 	} catch (CLParserException err) {
 		cout << err.what() << endl;
 		exit(-1);
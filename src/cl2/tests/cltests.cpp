@@ -0,0 +1,232 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// Regression tests. Each test runs a script in several ways and compares the printed
+// output with a plain interpreter run:
+//
+//   cltests jit scriptfile    - JIT compiling every function vs. CLJit::setEnabled(false)
+//   cltests save scriptfile   - save and reload the context every few frames, as FULL
+//                               saves, as DELTA chains and as lazy DELTA chains
+//   cltests native scriptfile - the script's CLTranslator module, linked into
+//                               cltests_native, vs. bytecode
+
+#include "cl2/cl2.h"
+
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// how the context is saved and reloaded while the script runs
+enum SaveMode { NO_SAVE, FULL_SAVE, DELTA_SAVE, LAZY_SAVE };
+
+static const int MAX_FRAMES = 100000;
+static const int SAVE_EVERY = 3;  // frames between saves
+static const int CHAIN_LENGTH = 4; // saves in a delta chain, the first one is a full save
+
+class Runner
+{
+public:
+	Runner(SaveMode mode, bool native = false) : mode(mode), native(native), saves(0) {}
+
+	// run a script to its end, return what it printed
+	string run(const string &path)
+	{
+		ostringstream out;
+		streambuf *old = cout.rdbuf(out.rdbuf());
+		try
+		{
+			CLContext context;
+			CLMathModule math;
+			context.addModule(&math);
+
+			CLValue fn = CLCompiler::compile(&context, path);
+			if (native && !GET_FUNCTION(fn)->native_code)
+				throw std::runtime_error("No native code for " + path);
+
+			CLValue thread(new CLThread(&context));
+			GET_THREAD(thread)->init(fn);
+
+			for (int frame = 1; context.countRunningThreads() > 0 && frame < MAX_FRAMES; ++frame)
+			{
+				context.completeJobs();
+				context.tick(10);
+				context.roundRobin(100);
+
+				if (mode != NO_SAVE && frame % SAVE_EVERY == 0) reload(context);
+			}
+		} catch (...) {
+			cout.rdbuf(old);
+			throw;
+		}
+		cout.rdbuf(old);
+		return out.str();
+	}
+
+private:
+	void save(CLContext &context)
+	{
+		bool full = mode == FULL_SAVE || saves % CHAIN_LENGTH == 0;
+		++saves;
+
+		stringstream ss;
+		CLSerialSaver S(ss);
+		S.setMode(full ? CLSerialSaver::FULL : CLSerialSaver::DELTA);
+		size_t block = S.beginBlock();
+		context.save(S);
+		S.endBlock(block);
+		context.saveRecords(S);
+		S.finish();
+
+		if (full) chain.clear();
+		chain.push_back(ss.str());
+	}
+
+	void reload(CLContext &context)
+	{
+		context.unmarkObjects();
+		context.markObjects();
+		context.sweepObjects();
+		context.finalizeObjects();
+
+		save(context);
+
+		stringstream ss(chain[0]);
+		CLSerialLoader L(ss, &context);
+		if (mode == LAZY_SAVE) L.setLazy(true, 0);
+
+		string roots;
+		L.readBlock(roots);
+		context.loadRecords(L);
+		for (size_t i = 1; i < chain.size(); ++i)
+		{
+			L.pushInput(chain[i]);
+			L.readBlock(roots);
+			context.loadRecords(L);
+			L.popInput();
+		}
+
+		L.pushInput(roots);
+		context.load(L);
+		L.popInput();
+		context.finishLoad(L);
+	}
+
+	SaveMode mode;
+	bool native; // the script must run from a native module
+	int saves;
+	vector<string> chain; // the current delta chain
+};
+
+static bool compare(const string &name, const string &expected, const string &result)
+{
+	if (result == expected) return true;
+
+	cout << name << " differs from the interpreter. Expected:" << endl << expected;
+	cout << "Got:" << endl << result;
+	return false;
+}
+
+static bool testJit(const string &path)
+{
+	CLJit::setEnabled(false);
+	string expected = Runner(NO_SAVE).run(path);
+
+	if (!CLJit::isAvailable())
+	{
+		cout << "No JIT on this platform" << endl;
+		return true;
+	}
+
+	unsigned threshold = CLJit::getThreshold();
+	CLJit::setEnabled(true);
+	CLJit::setThreshold(1);
+	string result = Runner(NO_SAVE).run(path);
+	CLJit::setThreshold(threshold);
+
+	return compare("JIT", expected, result);
+}
+
+static bool testSave(const string &path)
+{
+	string expected = Runner(NO_SAVE).run(path);
+
+	bool ok = compare("FULL", expected, Runner(FULL_SAVE).run(path));
+	ok = compare("DELTA", expected, Runner(DELTA_SAVE).run(path)) && ok;
+	ok = compare("Lazy DELTA", expected, Runner(LAZY_SAVE).run(path)) && ok;
+	return ok;
+}
+
+static bool testNative(const string &path)
+{
+	list<CLNativeModule*> &registered = CLNativeModule::getRegistered();
+	if (registered.empty()) throw std::runtime_error("No native modules linked in");
+
+	// leave the modules out of the context for the bytecode run
+	CLJit::setEnabled(false);
+	list<CLNativeModule*> modules;
+	modules.swap(registered);
+	string expected;
+	try
+	{
+		expected = Runner(NO_SAVE).run(path);
+	} catch (...) {
+		modules.swap(registered);
+		throw;
+	}
+	modules.swap(registered);
+
+	return compare("Native module", expected, Runner(NO_SAVE, true).run(path));
+}
+
+int main(int argc, char **args)
+{
+	if (argc != 3)
+	{
+		cout << "Syntax: " << args[0] << " jit|save|native scriptfile" << endl;
+		return 2;
+	}
+
+	string test = args[1];
+	bool ok;
+	try
+	{
+		if (test == "jit") ok = testJit(args[2]);
+		else if (test == "save") ok = testSave(args[2]);
+		else if (test == "native") ok = testNative(args[2]);
+		else
+		{
+			cout << "Unknown test " << test << endl;
+			return 2;
+		}
+	} catch (CLParserException &err) {
+		cout << err.what() << endl;
+		return 1;
+	} catch (std::exception &err) {
+		cout << err.what() << endl;
+		return 1;
+	}
+
+	return ok ? 0 : 1;
+}
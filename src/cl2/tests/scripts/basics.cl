@@ -0,0 +1,28 @@
+function fib(n) { if (n < 2) return (n); return (fib(n-1) + fib(n-2)); }
+sys.println("fib ", fib(20));
+local s = 0;
+local i; for (i = 0; i < 10; i = i + 1) { s = s + i; }
+local j;
+for (j = 0; j < 100000; j = j + 1) { s = s + 1; }
+sys.println("sum ", s);
+local a = array [3, 1, 4, 1, 5, 9, 2, 6];
+local t = [x = 1, y = 2, z = "str"];
+local v, k;
+foreach (v in a) { s = s + v; }
+foreach (k, v in t) { sys.println(k, "=", v); }
+foreach (k, v in a) { if (k == 3) break(); sys.print(k, ":", v, " "); }
+sys.println();
+sys.println("sum2 ", s);
+local w = 0;
+while (w < 5) { w = w + 1; if (w == 3) break(); }
+sys.println("w ", w);
+switch (w) { case (1) sys.println("one"); case (3) sys.println("three"); else sys.println("other"); }
+function loop(n, acc) { if (n == 0) return (acc); return (loop(n - 1, acc + n)); }
+sys.println("loop ", loop(1000, 0));
+local th = sys.startthread(function(n) { local q; for (q = 0; q < n; q = q + 1) { sys.println("thr ", q); yield(); } return (q); }, 3, null);
+yield(); yield(); yield(); yield();
+sys.println("thread result ", th.result);
+local f = 1.5 * 2;
+sys.println("float ", f, " ", 7 / 2, " ", 7 % 3, " ", 1 << 4, " ", not true, " ", 3 == 3.0);
+function outer() { local x = 5; local v; foreach (v in array[1,2,3]) { if (v == 2) return (v * x); } return (0); }
+sys.println("outer ", outer());
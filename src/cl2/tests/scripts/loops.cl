@@ -0,0 +1,22 @@
+local i, s = 0, v, k;
+for (i in 0..10) { s = s + i; }
+sys.println("range ", s, " ", i);
+s = 0; for (i in 5..5) { s = s + 1; } sys.println("empty ", s);
+s = 0; for (i in 0..2.5) { s = s + i; } sys.println("frange ", s);
+s = 0; for (i in 0..100) { if (i == 7) break(); s = s + i; } sys.println("break ", s);
+s = 0; for (i in 0..3) { i = 100; s = s + 1; } sys.println("assign ", s);
+s = 0; for (i = 0; i < 10; i = i + 1) { if (i == 4) break(); s = s + i; } sys.println("cfor ", s);
+s = 0; for (;;) { s = s + 1; if (s == 9) break(); } sys.println("inf ", s);
+for (i = 0; i < 0; i = i + 1) sys.println("never");
+local a = array[];
+foreach (v in a) sys.println("never");
+a = array [1, 2, 3];
+foreach (k, v in a) { sys.print(k, ":", v, " "); } sys.println();
+function f() { local i; for (i in 0..10) { if (i == 3) return (i * 10); } return (0); }
+sys.println("ret ", f());
+function g() { local x; foreach (x in array[4,5,6]) { if (x == 5) return (x); } return (0); }
+sys.println("ret2 ", g());
+local t = [q = 1];
+foreach (k, v in t) sys.println(k, " ", v);
+s = 0; for (i in 0..3) { local j; for (j in 0..i) s = s + 1; } sys.println("nested ", s);
+sys.println(1.5, " ", 2.25);
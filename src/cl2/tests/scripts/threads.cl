@@ -0,0 +1,19 @@
+local worker = sys.startthread(function(n) { local i; for (i = 0; i < n; i = i + 1) yield(); return (n * 10); }, 5, null);
+sys.println("joined ", sys.wait(worker));
+local k;
+for (k in 0..3) sys.startthread(function(id) { local v = sys.waitsignal("go"); sys.println("woke ", id, " ", v); return (v); }, k, null);
+yield(); yield(); yield();
+sys.println("signalled ", sys.signal("go", 42));
+function tw() { return (sys.waitsignal("tail")); }
+local tt = sys.startthread(tw, null);
+yield(); yield();
+sys.signal("tail", "tailres");
+sys.println("tail result ", sys.wait(tt));
+sys.sleep(50);
+sys.println("slept");
+local s = sys.startthread(function() { local c = 0; while (1) { c = c + 1; yield(); } }, null);
+s.suspend();
+yield(); yield();
+s.resume();
+s.kill();
+sys.println("end");
@@ -0,0 +1,28 @@
+world = [rooms = array [], log = array [], count = 0];
+local r;
+for (r in 0..20) {
+	local room = [id = r, items = array [], visited = false, name = "room"];
+	room.me = room;
+	world.rooms[r] = room;
+}
+function step(i) {
+	local room = world.rooms[i % 20];
+	room.items[i % 7] = [n = i, owner = room];
+	if (i % 5 == 0) room.visited = true;
+	if (i % 11 == 0) room.items = array [];
+	world.count = world.count + 1;
+	world.log[i % 30] = i;
+	if (i % 13 == 0) world.tmp = [x = i, y = array [i, i + 1]];
+	if (i % 17 == 0) world.tmp = null;
+}
+local f;
+for (f = 0; f < 300; f = f + 1) { step(f); yield(); }
+local sum = 0, v, k;
+foreach (v in world.rooms) {
+	local it;
+	foreach (it in v.items) { if (it) sum = sum + it.n; if (it) if (it.owner != v) sys.println("bad owner"); }
+	if (v.visited) sum = sum + 1000;
+	if (v.me != v) sys.println("bad self");
+}
+foreach (v in world.log) sum = sum + v;
+sys.println("sum ", sum, " count ", world.count, " tmp ", world.tmp);
@@ -31,10 +31,12 @@
 
 void CLArray::set(CLValue &key, CLValue &val)
 {
+	materialize();
 	if (key.type != CL_INTEGER) return;
 
 	int idx = key.toInt();
 	if (idx < 0) return;	// TODO
+	touch();
 
 	if (idx >= static_cast<int>(array.size())) array.resize(idx+1);
 
@@ -43,6 +45,7 @@ void CLArray::set(CLValue &key, CLValue &val)
 
 bool CLArray::get(CLValue &key, CLValue &val)
 {
+	materialize();
 	switch (key.type)
 	{
 		case CL_INTEGER: {
@@ -69,6 +72,7 @@ bool CLArray::get(CLValue &key, CLValue &val)
 
 CLValue CLArray::clone()
 {
+	materialize();
 	CLArray *dst = new CLArray(getContext());
 	CLArray *src = this;
 
@@ -78,6 +82,7 @@ CLValue CLArray::clone()
 
 std::string CLArray::toString()
 {
+	materialize();
 	std::stringstream ss;
 	ss << '[';
 	for (size_t i=0; i<array.size(); ++i)
@@ -90,6 +95,7 @@ std::string CLArray::toString()
 
 CLValue CLArray::begin()
 {
+	materialize();
 	if (array.empty()) 
 		return CLValue::Null(); 
 	else 
@@ -98,6 +104,7 @@ CLValue CLArray::begin()
 
 CLValue CLArray::next(CLValue iterator, CLValue &key, CLValue &value)
 {
+	materialize();
 	int it = iterator.toInt();
 	
 	key   = iterator;
@@ -112,23 +119,42 @@ CLValue CLArray::next(CLValue iterator, CLValue &key, CLValue &value)
 
 /*static member*/
 CLArray *CLArray::load(CLSerialLoader &S)
+{
+	CLArray *a = new CLArray(S.getContext()); S.addPtr(a);
+	loadInPlace(S, a);
+	return a;
+}
+
+/*static member*/
+void CLArray::loadInPlace(CLSerialLoader &S, CLArray *a)
 {
 	size_t size;
 	S.IO_size_t(size);
 
-	CLArray *a = new CLArray(S.getContext()); S.addPtr(a);
 	a->array.resize(size, CLValue());
 	for (size_t i=0; i<size; ++i)
 	{
 		a->array[i] = CLValue::load(S);
 	}
+}
 
-	return a;
+/*static member*/
+void CLArray::scanRecordRefs(CLSerialLoader &S, std::vector<unsigned int> &ids)
+{
+	size_t size;
+	S.IO_size_t(size);
+
+	for (size_t i=0; i<size; ++i)
+	{
+		CLValue::scanRecordRef(S, ids);
+	}
 }
 
 /*static member*/
 void CLArray::save(CLSerialSaver &S, CLArray *O)
 {
+	O->materialize();
+
 	size_t size = O->array.size();
 	S.IO_size_t(size);
 	
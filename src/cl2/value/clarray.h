@@ -46,8 +46,14 @@ public:
 	CLValue begin();
 	CLValue next(CLValue iterator, CLValue &key, CLValue &value);
 
+	// direct access (no bounds checks)
+	size_t size() { materialize(); return array.size(); }
+	const CLValue &at(size_t i) { materialize(); return array[i]; } // read only, set() marks changes for delta saves
+
 	// load/save
 	static CLArray *load(class CLSerialLoader &ss);
+	static void loadInPlace(class CLSerialLoader &ss, CLArray *O); // into a new, empty array
+	static void scanRecordRefs(class CLSerialLoader &ss, std::vector<unsigned int> &ids); // save ids a record refers to
 	static void save(class CLSerialSaver &ss, CLArray *O);
 
 private:
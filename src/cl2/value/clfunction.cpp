@@ -21,27 +21,46 @@
 #include "clfunction.h"
 #include "clvalue.h"
 
+#include "../compiler/clscriptlibrary.h"
 #include "../serialize/clserialloader.h"
 #include "../serialize/clserialsaver.h"
 #include "../vm/clcontext.h"
+#include "../vm/cljit.h"
+#include "../vm/clverifier.h"
 
 #include <sstream>
+#include <stdexcept>
 
 #include <iostream>
 using namespace std;
 
 CLFunction::CLFunction(CLContext *context)
-	: CLObject(context), num_args(0)
+	: CLObject(context), num_args(0), max_stack(0), jit_code(0), call_count(0), native_code(0), hash(0)
 {
 }
 
 CLFunction::~CLFunction()
 {
+	CLJit::release(this);
 }
 
 //static member
 void CLFunction::save(CLSerialSaver &S, CLFunction *O)
 {
+	// functions of script files are compiled again on load
+	CLScriptLibrary::Location location;
+	bool ref = S.getFunctionRefs() && CLScriptLibrary::find(O->getHash(), location);
+	S.IO(ref);
+	if (ref)
+	{
+		unsigned int hash_lo = (unsigned int)O->getHash(), hash_hi = (unsigned int)(O->getHash() >> 32);
+		S.IO(hash_lo);
+		S.IO(hash_hi);
+		S.IO(location.path);
+		S.IO(location.index);
+		return;
+	}
+
 	// write number of arguments
 	S.IO(O->num_args);
 	
@@ -79,6 +98,23 @@ void CLFunction::save(CLSerialSaver &S, CLFunction *O)
 //static member
 CLFunction *CLFunction::load(CLSerialLoader &S)
 {
+	bool ref;
+	S.IO(ref);
+	if (ref)
+	{
+		unsigned int hash_lo, hash_hi;
+		CLScriptLibrary::Location location;
+		S.IO(hash_lo);
+		S.IO(hash_hi);
+		S.IO(location.path);
+		S.IO(location.index);
+
+		unsigned long long hash = ((unsigned long long)hash_hi << 32) | hash_lo;
+		CLFunction *f = GET_FUNCTION(CLScriptLibrary::resolve(S.getContext(), hash, location, S.getScriptCache()));
+		S.addPtr(f);
+		return f;
+	}
+
 	CLFunction *f = new CLFunction(S.getContext()); S.addPtr(f);
 
 	// read number of argument
@@ -95,6 +131,7 @@ CLFunction *CLFunction::load(CLSerialLoader &S)
 		// read opcode
 		char opcode;
 		S.IO(opcode); inst.op = CLOpcode(opcode);
+		if ((opcode < 0) || (opcode >= NUM_OPCODES)) throw std::runtime_error("Invalid bytecode: unknown opcode");
 
 		// load argument, if any
 		CLOpcodeDesc desc = getOpcodeDesc(inst.op);
@@ -115,9 +152,76 @@ CLFunction *CLFunction::load(CLSerialLoader &S)
 		f->constants.push_back(CLValue::load(S));
 	}
 
+	f->link();
 	return f;
 }
 
+// FNV-1a
+static inline void hashBytes(unsigned long long &h, const void *data, size_t size)
+{
+	const unsigned char *p = static_cast<const unsigned char*>(data);
+	for (size_t i=0; i<size; ++i)
+	{
+		h ^= p[i];
+		h *= 1099511628211ULL;
+	}
+}
+
+void CLFunction::link()
+{
+	CLVerifier::verify(this);
+
+	unsigned long long h = 14695981039346656037ULL;
+
+	hashBytes(h, &num_args, sizeof(num_args));
+
+	size_t codesize = code.size();
+	for (size_t i=0; i<codesize; ++i)
+	{
+		CLInstruction &inst = code[i];
+
+		char opcode = inst.op;
+		hashBytes(h, &opcode, 1);
+
+		CLOpcodeDesc desc = getOpcodeDesc(inst.op);
+		switch (desc.arg_type)
+		{
+			case ARG_NONE: break;
+			case ARG_INTEGER: hashBytes(h, &inst.arg, sizeof(inst.arg)); break;
+			case ARG_FLOAT: hashBytes(h, &inst.arg_float, sizeof(inst.arg_float)); break;
+			case ARG_STRING: hashBytes(h, inst.arg_str.c_str(), inst.arg_str.size() + 1); break;
+		}
+	}
+
+	size_t size = constants.size();
+	for (size_t i=0; i<size; ++i)
+	{
+		CLValue &V = constants[i];
+		hashBytes(h, &V.type, sizeof(V.type));
+		switch (V.type)
+		{
+			case CL_FUNCTION:
+			{
+				unsigned long long fh = GET_FUNCTION(V)->getHash();
+				hashBytes(h, &fh, sizeof(fh));
+				break;
+			}
+			case CL_STRING:
+			{
+				std::string str = V.toString();
+				hashBytes(h, str.c_str(), str.size() + 1);
+				break;
+			}
+			case CL_INTEGER: hashBytes(h, &V.value.integer, sizeof(V.value.integer)); break;
+			case CL_FLOAT: hashBytes(h, &V.value.real, sizeof(V.value.real)); break;
+			default: break;
+		}
+	}
+
+	hash = h;
+	native_code = getContext()->getNativeFunctionPtr(hash);
+}
+
 CLValue CLFunction::clone()
 {
 	return CLValue(this);
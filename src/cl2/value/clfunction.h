@@ -24,6 +24,7 @@
 #include "clobject.h"
 #include "clvalue.h"
 #include "../clopcode.h"
+#include "../vm/clmodule.h"
 
 #include <vector>
 #include <string>
@@ -49,6 +50,19 @@ public:
 	std::vector<CLInstruction> code;
 	std::vector<CLValue> constants;
 	int num_args;
+	int max_stack; // maximum operand stack depth, see CLVerifier
+
+	// verify code, compute content hash and look up native implementation (call when code &
+	// constants are complete, throws std::runtime_error if code is invalid)
+	void link();
+	unsigned long long getHash() { return hash; }
+
+	// native code (see CLJit), created when call_count reaches the JIT threshold
+	struct CLJitCode *jit_code;
+	unsigned call_count;
+
+	// native code from a CLNativeModule, replaces bytecode & JIT
+	CLNativeFunctionPtr native_code;
 
 	// clone
 	virtual CLValue clone();
@@ -57,6 +71,8 @@ public:
 	virtual std::string toString();
 
 private:
+	unsigned long long hash;
+
 	// GC
 	virtual void markReferenced();
 };
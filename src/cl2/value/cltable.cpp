@@ -41,6 +41,8 @@ CLTable::~CLTable()
 
 void CLTable::clear()
 {
+	materialize();
+	touch();
 	delete [] slots;
 
 	size = MIN_SIZE;
@@ -53,6 +55,7 @@ void CLTable::clear()
 
 void CLTable::reserve(size_t reserve_size)
 {
+	materialize();
 	reserved = MIN_SIZE;
 	while (reserved < reserve_size) reserved *= 2;
 
@@ -122,6 +125,8 @@ CLTable::Slot *CLTable::FindSlot(CLValue &key, CLTable::Slot *s)
 
 bool CLTable::get(CLValue &key, CLValue &value)
 {
+	materialize();
+
 	// special key: "parent"
 	if ((key.type == CL_STRING) && (GET_STRING(key)->get() == "parent"))
 	{
@@ -145,6 +150,9 @@ bool CLTable::get(CLValue &key, CLValue &value)
 
 void CLTable::set(CLValue &key, CLValue &value)
 {
+	materialize();
+	touch();
+
 	// special keys: "parent", null
 	if ((key.type == CL_STRING) && (GET_STRING(key)->get() == "parent"))
 	{
@@ -231,6 +239,7 @@ void CLTable::set(CLValue &key, CLValue &value)
 
 CLValue CLTable::clone()
 {
+	materialize();
 	CLTable *dst = new CLTable(getContext());
 	CLTable *src = this;
 
@@ -248,6 +257,7 @@ CLValue CLTable::clone()
 
 std::string CLTable::toString()
 {
+	materialize();
 	std::stringstream ss;
 	ss << "[";
 
@@ -270,10 +280,12 @@ std::string CLTable::toString()
 
 bool CLTable::remove(CLValue &key)
 {
+	materialize();
 	Slot *main_slot = GetSlot(Hash(key));
 	Slot *slot = FindSlot(key, main_slot);
 
 	if (!slot) return false; // no node to remove
+	touch();
 
 	Slot *to_clear = slot;
 
@@ -323,6 +335,7 @@ void CLTable::markReferenced()
 // iteration support
 CLValue CLTable::begin()
 {
+	materialize();
 	for (size_t i=0; i<size; ++i)
 	{
 		if (!IsSlotFree(&slots[i])) return CLValue((int)i);
@@ -333,6 +346,7 @@ CLValue CLTable::begin()
 
 CLValue CLTable::next(CLValue iterator, CLValue &key, CLValue &value)
 {
+	materialize();
 	size_t it = (size_t)iterator.toInt();
 
 	// load key/value
@@ -355,6 +369,8 @@ CLValue CLTable::next(CLValue iterator, CLValue &key, CLValue &value)
 //static member
 void CLTable::save(CLSerialSaver &S, CLTable *table)
 {
+	table->materialize();
+
 	unsigned tmp;
 	S.IO(tmp = table->size); // slot size
 	S.IO(tmp = table->reserved); // reserved
@@ -385,7 +401,13 @@ void CLTable::save(CLSerialSaver &S, CLTable *table)
 CLTable *CLTable::load(CLSerialLoader &S)
 {
 	CLTable *table = new CLTable(S.getContext()); S.addPtr(table);
+	loadInPlace(S, table);
+	return table;
+}
 
+//static member
+void CLTable::loadInPlace(CLSerialLoader &S, CLTable *table)
+{
 	unsigned tmp;
 	size_t size, reserved;
 
@@ -426,7 +448,23 @@ CLTable *CLTable::load(CLSerialLoader &S)
 	}
 	assert(table->free_slot);
 	assert(table->fill < table->size);
+}
 
-	return table;
+//static member
+void CLTable::scanRecordRefs(CLSerialLoader &S, std::vector<unsigned int> &ids)
+{
+	unsigned tmp;
+	size_t size;
+
+	S.IO(tmp); size = tmp; // slot size
+	S.IO(tmp); // reserved value
+	CLValue::scanRecordRef(S, ids); // parent
+
+	for (size_t i=0; i<size; ++i)
+	{
+		CLValue::scanRecordRef(S, ids); // key
+		CLValue::scanRecordRef(S, ids); // value
+		int next; S.IO(next);
+	}
 }
 
@@ -33,8 +33,8 @@ public:
 	virtual ~CLTable();
 
 	// set/get parent table
-	void setParent(CLValue parent) { this->parent = parent; }
-	CLValue getParent() { return this->parent; } 
+	void setParent(CLValue parent) { materialize(); this->parent = parent; touch(); }
+	CLValue getParent() { materialize(); return this->parent; }
 
 	// get/set/remove slots
 	virtual bool get(CLValue &key, CLValue &value);
@@ -48,7 +48,7 @@ public:
 	virtual std::string toString();
 	
 	void clear();
-	size_t slotsUsed() { return fill; }
+	size_t slotsUsed() { materialize(); return fill; }
 	void reserve(size_t min_size);
 
 	// iteration support:
@@ -58,6 +58,8 @@ public:
 	// load/save
 	static void save(class CLSerialSaver &S, CLTable *table);
 	static CLTable *load(class CLSerialLoader &S);
+	static void loadInPlace(class CLSerialLoader &S, CLTable *table); // into a new, empty table
+	static void scanRecordRefs(class CLSerialLoader &S, std::vector<unsigned int> &ids); // save ids a record refers to
 
 private:
 	static const size_t MIN_SIZE = 4;
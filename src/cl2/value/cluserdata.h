@@ -43,6 +43,10 @@ public:
 	// serializasion support (behaviour depends on the CLSerializer's CLUserDataSerializer)
 	static CLUserData *load(class CLSerialLoader &S);
 	static void save(class CLSerialSaver &S, CLUserData *userdata);
+
+protected:
+	// engine objects keep their state natively without touch(), so they're always saved
+	virtual bool isDirty() { return true; }
 };
 
 #endif
@@ -30,6 +30,7 @@
 #include "cluserdata.h"
 
 #include "../vm/clthread.h"
+#include "../vm/clfuture.h"
 #include "../vm/clcontext.h"
 
 #include "../serialize/clserialloader.h"
@@ -37,6 +38,7 @@
 
 #include <sstream>
 #include <iomanip>
+#include <stdexcept>
 #include <cstring>
 #include <assert.h>
 #include <float.h>
@@ -83,6 +85,12 @@ CLValue::CLValue(CLThread *thread)
 	value.object = thread;
 }
 
+CLValue::CLValue(CLFuture *future)
+{
+	type = CL_FUTURE;
+	value.object = future;
+}
+
 std::string CLValue::toString()
 {
 	switch (type)
@@ -133,6 +141,7 @@ std::string CLValue::typeString()
 		case CL_EXTERNALFUNCTION: return "external_function";
 		case CL_USERDATA: return "userdata";
 		case CL_THREAD: return "thread";
+		case CL_FUTURE: return "future";
 	}
 
 	assert(0);
@@ -436,7 +445,8 @@ CLValue CLValue::op_ge(CLValue other)
 
 #undef ARITH_COMPARE_OPERATION
 
-#define STACKREF 0x000000FF
+#define STACKREF  0x000000FF
+#define RECORDREF 0x000000FE
 
 /*static member*/
 CLValue CLValue::load(class CLSerialLoader &S)
@@ -449,6 +459,13 @@ CLValue CLValue::load(class CLSerialLoader &S)
 		case CL_RAW_NULL:
 			return Null();
 
+		case CL_RAW_BOOLEAN:
+		{
+			bool b;
+			S.IO(b);
+			return b ? True() : False();
+		}
+
 		case CL_RAW_INTEGER:
 			S.IO(tmp);
 			return CLValue(tmp);
@@ -502,19 +519,26 @@ CLValue CLValue::load(class CLSerialLoader &S)
 			CLThread *t = CLThread::load(S);
 			return CLValue(t);
 		}
+
+		case CL_RAW_FUTURE:
+		{
+			CLFuture *f = CLFuture::load(S);
+			return CLValue(f);
+		}
 			
 		case STACKREF: 
 		{
 			int ref_id; S.IO(ref_id);
-			CLObject *obj = (CLObject*)S.getPtr(ref_id);
-			if (dynamic_cast<CLString*>(obj)) return CLValue((CLString*)obj);
-			if (dynamic_cast<CLArray*>(obj)) return CLValue((CLArray*)obj);
-			if (dynamic_cast<CLFunction*>(obj)) return CLValue((CLFunction*)obj);
-			if (dynamic_cast<CLExternalFunction*>(obj)) return CLValue((CLExternalFunction*)obj);
-			if (dynamic_cast<CLTable*>(obj)) return CLValue((CLTable*)obj);
-			if (dynamic_cast<CLUserData*>(obj)) return CLValue((CLUserData*)obj);
-			if (dynamic_cast<CLThread*>(obj)) return CLValue((CLThread*)obj);
-			assert(0);
+			return fromObject((CLObject*)S.getPtr(ref_id));
+		}
+
+		case RECORDREF:
+		{
+			unsigned int save_id; S.IO(save_id);
+			CLObject *obj = S.findRecord(save_id);
+			if (obj) return fromObject(obj);
+
+			return loadRecord(S, save_id);
 		}
 
 	}
@@ -523,6 +547,91 @@ CLValue CLValue::load(class CLSerialLoader &S)
 	return CLValue::Null();
 }
 
+/*static member*/
+CLValue CLValue::loadRecord(class CLSerialLoader &S, unsigned int save_id)
+{
+	CLValue value;
+
+	if (S.isLazyRecord(save_id))
+	{
+		// a proxy, loaded in place on first access
+		if (S.recordType(save_id) == CL_RAW_TABLE) value = CLValue(new CLTable(S.getContext()));
+		else value = CLValue(new CLArray(S.getContext()));
+
+		GET_OBJECT(value)->save_lazy = true;
+		S.addProxy(save_id, GET_OBJECT(value));
+	}
+	else
+	{
+		if (!S.beginRecord(save_id)) throw std::runtime_error("Invalid savegame: missing object record");
+		value = load(S);
+		S.endRecord(save_id);
+		if (!value.isObject()) throw std::runtime_error("Invalid savegame: object record without object");
+	}
+
+	// loaded as it was saved: part of the chain, and unchanged
+	CLCollectable *obj = GET_OBJECT(value);
+	obj->save_id = save_id;
+	obj->save_dirty = false;
+	return value;
+}
+
+/*static member*/
+void CLValue::scanRecordRef(class CLSerialLoader &S, std::vector<unsigned int> &ids)
+{
+	// (in a record, objects are always referred to by their save id)
+	int id, tmp;
+	S.IO(id);
+
+	switch (id)
+	{
+		case CL_RAW_NULL:
+			return;
+
+		case CL_RAW_BOOLEAN:
+		{
+			bool b;
+			S.IO(b);
+			return;
+		}
+
+		case CL_RAW_INTEGER:
+			S.IO(tmp);
+			return;
+
+		case CL_RAW_FLOAT:
+		{
+			float f;
+			S.IO(f);
+			return;
+		}
+
+		case RECORDREF:
+		{
+			unsigned int save_id; S.IO(save_id);
+			ids.push_back(save_id);
+			return;
+		}
+	}
+
+	throw std::runtime_error("Invalid savegame: object inside a record");
+}
+
+/*static member*/
+CLValue CLValue::fromObject(CLObject *obj)
+{
+	if (dynamic_cast<CLString*>(obj)) return CLValue((CLString*)obj);
+	if (dynamic_cast<CLArray*>(obj)) return CLValue((CLArray*)obj);
+	if (dynamic_cast<CLFunction*>(obj)) return CLValue((CLFunction*)obj);
+	if (dynamic_cast<CLExternalFunction*>(obj)) return CLValue((CLExternalFunction*)obj);
+	if (dynamic_cast<CLTable*>(obj)) return CLValue((CLTable*)obj);
+	if (dynamic_cast<CLUserData*>(obj)) return CLValue((CLUserData*)obj);
+	if (dynamic_cast<CLThread*>(obj)) return CLValue((CLThread*)obj);
+	if (dynamic_cast<CLFuture*>(obj)) return CLValue((CLFuture*)obj);
+	assert(0);
+	return CLValue::Null();
+}
+
 /*static member*/
 void CLValue::save(class CLSerialSaver &S, CLValue V)
 {
@@ -535,6 +644,14 @@ void CLValue::save(class CLSerialSaver &S, CLValue V)
 			S.IO(id = CL_RAW_NULL);
 			return;
 
+		case CL_BOOLEAN:
+		{
+			bool b = V.value.boolean;
+			S.IO(id = CL_RAW_BOOLEAN);
+			S.IO(b);
+			return;
+		}
+
 		case CL_INTEGER:
 			S.IO(id = CL_RAW_INTEGER);
 			S.IO(tmp = V.toInt());
@@ -552,6 +669,24 @@ void CLValue::save(class CLSerialSaver &S, CLValue V)
 			break; //handled below
 	}
 
+	// record modes: refer to the object by its save id, it's written as a record later on
+	if (S.getMode() != CLSerialSaver::INLINE)
+	{
+		CLCollectable *obj = GET_OBJECT(V);
+		bool write = (obj->save_id == 0) || ((S.getMode() == CLSerialSaver::DELTA) && obj->isDirty());
+
+		if (obj->save_id == 0) obj->save_id = obj->getContext()->newSaveId();
+		if (write && (S.findPtr(obj) == -1))
+		{
+			S.addPtr(obj);
+			S.queueRecord(V);
+		}
+
+		S.IO(id = RECORDREF);
+		S.IO(obj->save_id);
+		return;
+	}
+
 	// handle objects
 	int ref_id = S.findPtr(GET_OBJECT(V));
 	if (ref_id != -1) // object was already written? -> write reference id
@@ -562,7 +697,15 @@ void CLValue::save(class CLSerialSaver &S, CLValue V)
 	}
 
 	// object was not yet written? -> serialize it
-	ref_id = S.addPtr(GET_OBJECT(V));
+	S.addPtr(GET_OBJECT(V));
+	saveObject(S, V);
+}
+
+/*static member*/
+void CLValue::saveObject(class CLSerialSaver &S, CLValue V)
+{
+	int id;
+
 	switch (V.type)
 	{
 		case CL_STRING:
@@ -600,11 +743,17 @@ void CLValue::save(class CLSerialSaver &S, CLValue V)
 			CLThread::save(S, GET_THREAD(V));
 			break;
 
+		case CL_FUTURE:
+			S.IO(id = CL_RAW_FUTURE);
+			CLFuture::save(S, GET_FUTURE(V));
+			break;
+
 		default: assert(0);
 	}
 }
 
 #undef STACKREF
+#undef RECORDREF
 
 // static member
 void CLValue::saveVector(CLSerialSaver &S, std::vector<CLValue> V)
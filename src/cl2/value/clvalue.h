@@ -35,6 +35,7 @@
 #define CL_RAW_EXTERNALFUNCTION 0x07
 #define CL_RAW_USERDATA         0x08
 #define CL_RAW_THREAD           0x09
+#define CL_RAW_FUTURE           0x0A
 #define CL_RAW_BOOLEAN          0x10
 
 #define CL_RAW_ISNUMERIC       0x1000
@@ -53,7 +54,8 @@ enum CLValueType
 	CL_USERDATA          = CL_RAW_USERDATA         | CL_RAW_ISOBJECT,
 	CL_FUNCTION          = CL_RAW_FUNCTION         | CL_RAW_ISOBJECT,
 	CL_EXTERNALFUNCTION  = CL_RAW_EXTERNALFUNCTION | CL_RAW_ISOBJECT,
-	CL_THREAD            = CL_RAW_THREAD           | CL_RAW_ISOBJECT
+	CL_THREAD            = CL_RAW_THREAD           | CL_RAW_ISOBJECT,
+	CL_FUTURE            = CL_RAW_FUTURE           | CL_RAW_ISOBJECT
 };
 
 #define GET_OBJECT(v)           ((v).value.object)
@@ -64,6 +66,7 @@ enum CLValueType
 #define GET_EXTERNALFUNCTION(v) ((CLExternalFunction*)(v).value.object)
 #define GET_USERDATA(v)         ((CLUserData*)(v).value.object)
 #define GET_THREAD(v)           ((CLThread*)(v).value.object)
+#define GET_FUTURE(v)           ((CLFuture*)(v).value.object)
 
 class CLValue
 {
@@ -91,6 +94,7 @@ public:
 	explicit CLValue(class CLExternalFunction *extfunc);
 	explicit CLValue(class CLUserData *userdata);
 	explicit CLValue(class CLThread *thread);
+	explicit CLValue(class CLFuture *future);
 
 	// clone inside object, or copy inside value //
 	CLValue clone();
@@ -166,6 +170,11 @@ public:
 	// load/save //////////////////////////////////
 	static CLValue load(class CLSerialLoader &S);
 	static void save(class CLSerialSaver &S, CLValue V);
+	static void saveObject(class CLSerialSaver &S, CLValue V); // the object itself, no reference
+	static CLValue loadRecord(class CLSerialLoader &S, unsigned int save_id); // a record's object (or its proxy)
+	static void scanRecordRef(class CLSerialLoader &S, std::vector<unsigned int> &ids); // skip a value of a record, collect the save id it refers to
+
+	static CLValue fromObject(class CLObject *obj);
 
 	static std::vector<CLValue> loadVector(class CLSerialLoader &S);
 	static void saveVector(class CLSerialSaver &S, std::vector<CLValue> V);
@@ -25,7 +25,7 @@
 using namespace std;
 
 CLCollectable::CLCollectable(CLContext *context) 
-	: marked(false), context(context), prev(0), next(0)
+	: marked(false), save_id(0), save_dirty(true), save_lazy(false), context(context), prev(0), next(0)
 {
 	getContext()->addToHeapList(this);
 }
@@ -33,3 +33,13 @@ CLCollectable::CLCollectable(CLContext *context)
 CLCollectable::~CLCollectable()
 {
 }
+
+void CLCollectable::loadLazy()
+{
+	getContext()->materialize(this);
+}
+
+void CLCollectable::markRecord()
+{
+	getContext()->markRecordRefs(this);
+}
@@ -46,15 +46,30 @@ protected:
 		{
 			marked = true;
 			markReferenced();
+			if (save_lazy) markRecord();
 		}
 	}
 	
 	virtual void markReferenced() = 0;
 	virtual bool finalize() { return true; }
 
+	// delta saves (see CLSerialSaver::DELTA): call touch() whenever the saved state changes.
+	// Objects whose state isn't tracked that way override isDirty() instead.
+	inline void touch() { save_dirty = true; }
+	virtual bool isDirty() { return save_dirty; }
+
+	// lazy loading (see CLSerialLoader::setLazy): call materialize() before accessing the state
+	inline void materialize() { if (save_lazy) loadLazy(); }
+
 private:
 	bool marked;
 
+	unsigned int save_id; // id in the current save chain, 0 if not saved yet
+	bool save_dirty;      // changed since it was last saved
+	bool save_lazy;       // state is still in its save record
+	void loadLazy();
+	void markRecord();    // mark the objects the save record refers to
+
 	CLContext *context;
 	CLCollectable *prev, *next;
 };
@@ -21,13 +21,19 @@
 #include "clcontext.h"
 
 #include "../value/clvalue.h"
+#include "../value/clarray.h"
 #include "../value/cltable.h"
 #include "../value/clstring.h"
 
 #include "clmathmodule.h"
+#include "clnativemodule.h"
+#include "clfuture.h"
 
 #include <assert.h>
+#include <chrono>
 #include <iostream>
+#include <set>
+#include <sstream>
 
 #include "../serialize/clserialloader.h"
 #include "../serialize/clserialsaver.h"
@@ -40,10 +46,16 @@ using namespace std;
 // Construction/Destruction                                                   //
 ////////////////////////////////////////////////////////////////////////////////
 
-CLContext::CLContext() : gc_heap_list(0), gc_finalize_list(0)
+CLContext::CLContext() 
+	: threads(0), num_threads(0), sched_round(0), call_thread(0), next_job(0), next_save_id(1), gc_heap_list(0), gc_finalize_list(0)
 {
 	clear();
 	addModule(&sys);
+
+	// native code of script functions
+	std::list<CLNativeModule*> &native = CLNativeModule::getRegistered();
+	std::list<CLNativeModule*>::iterator it = native.begin(), end = native.end();
+	for (;it!=end;++it) addModule(*it);
 }
 
 CLContext::~CLContext()
@@ -60,6 +72,7 @@ void CLContext::clear()
 	shutdown();
 
 	root_table = CLValue(new CLTable(this));
+	deleted_save_ids.clear(); // (next_save_id stays, loadRecords sets it before load clears the context)
 
 	// reinit all modules
 	std::list<CLModule*>::iterator it = modules.begin(), end = modules.end();
@@ -71,8 +84,16 @@ void CLContext::clear()
 
 void CLContext::shutdown()
 {
-	// I. Free root table
+	// Jobs still running may refer to the objects freed below
+	workers.wait(true);
+	unsigned long id;
+	CLWorkerPool::Completion completion;
+	while (workers.pop(id, completion)) {}
+	jobs.clear();
+
+	// I. Free root table (and the objects lazy ones might refer to)
 	root_table.setNull();
+	lazy_records.reset();
 
 	// II. Move all remaining objects on heap to finalize list
 	while (gc_heap_list)
@@ -82,11 +103,16 @@ void CLContext::shutdown()
 
 	// III. Free finalized objects
 	finalizeObjects();
+	call_thread = 0;
 
 #ifdef DEBUG
 	if (gc_heap_list != 0)      clog << "Internal error: gc_heap_list != 0 after shutdown" << endl;
 	if (gc_finalize_list != 0)  clog << "Internal error: gc_finalize_list != 0 after shutdown" << endl;
-	if (threads.size() != 0)    clog << "Internal error: threads.size() != 0 after shutdown" << endl;
+	if (threads != 0)           clog << "Internal error: threads != 0 after shutdown" << endl;
+	for (int p=0; p<CLThread::NUM_PRIORITIES; ++p)
+		if (!ready[p].empty())  clog << "Internal error: ready queue not empty after shutdown" << endl;
+	if (!signal_queues.empty())
+		clog << "Internal error: scheduler queues not empty after shutdown" << endl;
 #endif
 
 	// Should be 0 anyway..
@@ -98,48 +124,206 @@ void CLContext::shutdown()
 // Threads                                                                    //
 ////////////////////////////////////////////////////////////////////////////////
 
-void CLContext::registerThread(CLValue thread) // called by thread constructor
+void CLContext::registerThread(CLThread *thread) // called by thread constructor
+{
+	thread->all_prev = 0;
+	thread->all_next = threads;
+	if (threads) threads->all_prev = thread;
+	threads = thread;
+	++num_threads;
+}
+
+void CLContext::unregisterThread(CLThread *thread) // called by thread destructor
 {
-	assert(thread.type == CL_THREAD);
+	assert(thread->queue == 0); // killed threads have left the scheduler
 
-	threads.push_back(thread);
+	if (thread->all_prev) thread->all_prev->all_next = thread->all_next; else threads = thread->all_next;
+	if (thread->all_next) thread->all_next->all_prev = thread->all_prev;
+	thread->all_prev = thread->all_next = 0;
+	--num_threads;
 }
 
-void CLContext::unregisterThread(CLValue thread) // called by thread destructor
+CLValue CLContext::call(CLValue fn, CLValue self, std::vector<CLValue> args)
 {
-	assert(thread.type == CL_THREAD);
+	if (!call_thread) call_thread = new CLThread(this);
+	return call_thread->call(fn, args, self);
+}
 
-	std::list<CLValue>::iterator it = threads.begin(), end = threads.end();
-	for (;it!=end;++it)
+CLValue CLContext::newThread()
+{
+	CLThread *t = thread_pool.pop();
+	if (!t) t = new CLThread(this);
+	return CLValue(t);
+}
+
+void CLContext::recycleThread(CLValue thread)
+{
+	static const size_t max_pool_size = 64;
+
+	CLThread *t = GET_THREAD(thread);
+	if (t->isRunning() || t->inside_run_method || t->shared || (t->queue != 0)) return;
+	if (thread_pool.size() >= max_pool_size) return;
+
+	t->reset();
+	thread_pool.push(t);
+
+	// it leaves the pool as a new thread: drop its record from the save chain
+	if (t->save_id)
 	{
-		if (GET_THREAD(thread) == GET_THREAD(*it)) 
-		{
-			it = threads.erase(it); 
-			return; 
-		}
+		deleted_save_ids.push_back(t->save_id);
+		t->save_id = 0;
 	}
-
-	clog << "Internal vm error: unregisterThread failed." << endl;
-	assert(0);
 }
 
 int CLContext::countRunningThreads()
 {
 	int result = 0;
 
-	std::list<CLValue>::iterator it = threads.begin(), end = threads.end();
-	for (;it!=end;++it) if (GET_THREAD(*it)->isRunning()) ++result; 
+	for (CLThread *t = threads; t; t = t->all_next) if (t->isRunning()) ++result; 
 
 	return result;
 }
 
+bool CLContext::hasReadyThreads()
+{
+	for (int p=0; p<CLThread::NUM_PRIORITIES; ++p) if (!ready[p].empty()) return true;
+	return false;
+}
+
 void CLContext::roundRobin(int timeout)
 {
-	std::list<CLValue>::iterator it = threads.begin(), end = threads.end();
-	for (;it!=end;++it)
+	// Each ready thread runs once, then moves to the back of the queue. Threads that block or
+	// finish leave the queue, threads started or woken meanwhile are appended and run this round.
+	++sched_round;
+	for (int p=0; p<CLThread::NUM_PRIORITIES; ++p)
+	{
+		CLThreadQueue &queue = ready[p];
+		while (!queue.empty())
+		{
+			CLThread *t = queue.front();
+			if (t->sched_round == sched_round) break; // everyone had its turn
+
+			t->sched_round = sched_round;
+			t->run(timeout);
+
+			if (t->queue == &queue) { queue.remove(t); queue.push(t); }
+		}
+	}
+}
+
+void CLContext::schedule(long budget, int slice)
+{
+	// Like roundRobin, but a thread's turn ends when it yields, blocks or finishes. When the
+	// budget is spent, each remaining class still gets a single slice, so background threads
+	// can't starve completely. A preempted thread stays at the front of its queue and finishes
+	// its turn first next time.
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point deadline = Clock::now() + std::chrono::microseconds(budget);
+
+	++sched_round;
+	for (int p=0; p<CLThread::NUM_PRIORITIES; ++p)
 	{
-		CLValue &thread = *it;
-		if (GET_THREAD(thread)->isRunning()) GET_THREAD(thread)->run(timeout);
+		CLThreadQueue &queue = ready[p];
+		bool has_run = false, out_of_time = false;
+		while (!queue.empty() && !out_of_time)
+		{
+			CLThread *t = queue.front();
+			if (t->sched_round == sched_round) break; // everyone had its turn
+
+			t->sched_round = sched_round;
+			do {
+				if (has_run && (Clock::now() >= deadline)) { out_of_time = true; break; }
+				t->run(slice);
+				has_run = true;
+			} while (t->wasPreempted() && (t->queue == &queue));
+
+			if (!out_of_time && (t->queue == &queue)) { queue.remove(t); queue.push(t); }
+		}
+	}
+}
+
+int CLContext::signal(const std::string &name, CLValue value)
+{
+	// wake threads in the order they started waiting (the queue is erased with its last thread)
+	int result = 0;
+	std::map<std::string, CLThreadQueue>::iterator it;
+	while ((it = signal_queues.find(name)) != signal_queues.end())
+	{
+		it->second.front()->wake(value);
+		++result;
+	}
+	return result;
+}
+
+void CLContext::tick(unsigned long ms)
+{
+	CLTimerWheel::Node *node = timers.advance(ms);
+	while (node)
+	{
+		CLTimerWheel::Node *next = node->next;
+		CLThread *thread = static_cast<CLThread*>(node->data);
+		if (thread->wait == CLThread::WAIT_TIMER) thread->wake();
+		node = next;
+	}
+}
+
+CLValue CLContext::async(CLWorkerPool::Job job, unsigned long *id)
+{
+	CLValue future = CLValue(new CLFuture(this));
+	unsigned long job_id = ++next_job;
+	jobs[job_id] = future;
+	workers.push(job_id, job);
+	if (id) *id = job_id;
+	return future;
+}
+
+CLValue CLContext::asyncThread(CLWorkerPool::Job job)
+{
+	CLValue future = CLValue(new CLFuture(this));
+	unsigned long job_id = ++next_job;
+	jobs[job_id] = future;
+	workers.pushThread(job_id, job);
+	return future;
+}
+
+int CLContext::completeJobs()
+{
+	int count = 0;
+	unsigned long id;
+	CLWorkerPool::Completion completion;
+	while (workers.pop(id, completion))
+	{
+		std::map<unsigned long, CLValue>::iterator it = jobs.find(id);
+		if (it == jobs.end()) continue;
+		CLValue future = it->second;
+		jobs.erase(it);
+
+		try {
+			GET_FUTURE(future)->complete(completion(this));
+		} catch (std::exception &e) {
+			GET_FUTURE(future)->fail(e.what());
+		}
+		++count;
+	}
+	return count;
+}
+
+void CLContext::waitJobs()
+{
+	while (!jobs.empty())
+	{
+		workers.wait();
+		completeJobs();
+	}
+}
+
+void CLContext::waitJob(unsigned long id)
+{
+	completeJobs();
+	while (jobs.find(id) != jobs.end())
+	{
+		workers.waitFinished();
+		completeJobs();
 	}
 }
 
@@ -158,6 +342,17 @@ CLExternalFunctionPtr CLContext::getExternalFunctionPtr(const std::string &func_
 	return 0;
 }
 
+CLNativeFunctionPtr CLContext::getNativeFunctionPtr(unsigned long long hash)
+{
+	std::list<CLModule*>::iterator it = modules.begin(), end = modules.end();
+	for (;it!=end;++it)
+	{
+		CLNativeFunctionPtr p = (*it)->getNativeFunctionPtr(hash);
+		if (p) return p;
+	}
+	return 0;
+}
+
 void CLContext::addModule(CLModule *module)
 {
 	modules.push_back(module);
@@ -184,15 +379,32 @@ CLValue CLContext::getGlobal(const std::string &id)
 
 void CLContext::save(CLSerialSaver &S)
 {
+	// (futures of running jobs are saved pending, they fail when loaded, see CLFuture::load)
+	if (S.getMode() == CLSerialSaver::FULL)
+	{
+		materializeAll(); // (proxies refer to records by the ids of the old chain)
+		resetSaveIds();   // start a new chain
+	}
+
 	CLValue::save(S, root_table); // save global environment
 
 	unsigned int tmp;
-	S.IO(tmp = threads.size());  // save number of threads
+	S.IO(tmp = num_threads - thread_pool.size() - (call_thread ? 1 : 0));  // save number of threads
+
+	for (CLThread *t = threads; t; t = t->all_next) // save each thread (except pooled ones and the call thread)
+	{
+		if ((t->queue != &thread_pool) && (t != call_thread)) CLValue::save(S, CLValue(t));
+	}
 
-	std::list<CLValue>::iterator it = threads.begin(), end = threads.end();
-	for (;it!=end;++it) // save each thread
+	// threads re-enter the scheduler as they are loaded; keep the order of the queues
+	for (int p=0; p<CLThread::NUM_PRIORITIES; ++p) saveQueue(S, ready[p]);
+	S.IO(tmp = signal_queues.size());
+	std::map<std::string, CLThreadQueue>::iterator it = signal_queues.begin(), end = signal_queues.end();
+	for (;it!=end;++it)
 	{
-		CLValue::save(S, *it);
+		std::string name = it->first;
+		S.IO(name);
+		saveQueue(S, it->second);
 	}
 }
 
@@ -209,6 +421,271 @@ void CLContext::load(CLSerialLoader &S)
 	{
 		CLValue thr = CLValue::load(S);
 	}
+
+	for (int p=0; p<CLThread::NUM_PRIORITIES; ++p) loadQueue(S, ready[p]);
+	S.IO(tmp);
+	for (unsigned i=0; i<tmp; ++i)
+	{
+		std::string name;
+		S.IO(name);
+		std::map<std::string, CLThreadQueue>::iterator it = signal_queues.find(name);
+		if (it == signal_queues.end()) throw std::runtime_error("Invalid context: signal queue without threads");
+		loadQueue(S, it->second);
+	}
+}
+
+void CLContext::saveRecords(CLSerialSaver &S)
+{
+	unsigned int tmp;
+
+	// changed objects, which aren't necessarily referred to by anything written in this delta
+	if (S.getMode() == CLSerialSaver::DELTA)
+	{
+		for (CLCollectable *it = gc_heap_list; it; it = it->next)
+		{
+			if (it->save_id && it->isDirty() && (S.findPtr(it) == -1))
+			{
+				S.addPtr(it);
+				S.queueRecord(CLValue::fromObject(static_cast<CLObject*>(it)));
+			}
+		}
+	}
+
+	// write records until no more objects are queued
+	CLValue value;
+	while (S.nextRecord(value))
+	{
+		CLCollectable *obj = GET_OBJECT(value);
+		obj->save_dirty = false;
+
+		S.IO(obj->save_id);
+		size_t block = S.beginBlock();
+		CLValue::saveObject(S, value);
+		S.endBlock(block);
+	}
+	S.IO(tmp = 0);
+
+	// records to drop from the chain
+	S.IO(tmp = deleted_save_ids.size());
+	for (size_t i=0; i<deleted_save_ids.size(); ++i) S.IO(deleted_save_ids[i]);
+	deleted_save_ids.clear();
+
+	S.IO(next_save_id);
+}
+
+void CLContext::loadRecords(CLSerialLoader &S)
+{
+	unsigned int save_id, tmp;
+
+	for (S.IO(save_id); save_id != 0; S.IO(save_id))
+	{
+		std::string data;
+		S.readBlock(data);
+		S.addRecord(save_id, data);
+	}
+
+	S.IO(tmp);
+	for (unsigned i=0; i<tmp; ++i)
+	{
+		S.IO(save_id);
+		S.removeRecord(save_id);
+	}
+
+	S.IO(next_save_id);
+}
+
+void CLContext::finishLoad(CLSerialLoader &S)
+{
+	// Objects only proxies refer to may not be left for later if the host (userdata) or the
+	// loader (function references) is involved. Walk the records of the proxies, and of the
+	// tables and arrays they refer to, and load the other objects found. Records nothing
+	// loaded refers to (objects freed without the chain knowing) are dropped.
+	std::shared_ptr<CLRecordStore> store = S.getRecordStore();
+	std::set<unsigned int> seen;
+	std::vector<unsigned int> pending, refs;
+	std::unordered_map<unsigned int, std::vector<unsigned int> > scanned; // refs by record
+	for (;;)
+	{
+		// (loading objects may add proxies)
+		std::unordered_map<unsigned int, CLObject*>::const_iterator it = store->getObjects().begin(), end = store->getObjects().end();
+		for (; it!=end; ++it)
+		{
+			if (it->second->save_lazy && seen.insert(it->first).second) pending.push_back(it->first);
+		}
+		if (pending.empty()) break;
+
+		while (!pending.empty())
+		{
+			unsigned int id = pending.back();
+			const std::string *data = store->find(id);
+			pending.pop_back();
+			if (!data) continue;
+
+			int type;
+			refs.clear();
+			S.pushInput(*data);
+			S.IO(type);
+			if (type == CL_RAW_TABLE) CLTable::scanRecordRefs(S, refs);
+			else if (type == CL_RAW_ARRAY) CLArray::scanRecordRefs(S, refs);
+			S.popInput();
+
+			for (size_t i=0; i<refs.size(); ++i)
+			{
+				if (!seen.insert(refs[i]).second) continue;
+
+				CLObject *obj = store->getObject(refs[i]);
+				if (obj)
+				{
+					if (obj->save_lazy) pending.push_back(refs[i]);
+					continue;
+				}
+
+				type = S.recordType(refs[i]);
+				if ((type == CL_RAW_TABLE) || (type == CL_RAW_ARRAY)) pending.push_back(refs[i]);
+				else if ((type != -1) && (type != CL_RAW_STRING)) CLValue::loadRecord(S, refs[i]);
+			}
+			scanned[id].swap(refs);
+		}
+	}
+
+	std::vector<unsigned int> ids = store->getIds();
+	for (size_t i=0; i<ids.size(); ++i)
+	{
+		if (!seen.count(ids[i]) && !store->getObject(ids[i])) store->remove(ids[i]);
+	}
+
+	// The GC only needs the refs that lead to loaded objects (see markRecordRefs): find the
+	// records that do, going back from the objects
+	std::unordered_map<unsigned int, std::vector<unsigned int> > referrers;
+	std::set<unsigned int> leading;
+	std::unordered_map<unsigned int, std::vector<unsigned int> >::iterator sit, send = scanned.end();
+	for (sit = scanned.begin(); sit != send; ++sit)
+	{
+		for (size_t i=0; i<sit->second.size(); ++i)
+		{
+			unsigned int ref = sit->second[i];
+			if (!store->getObject(ref)) referrers[ref].push_back(sit->first);
+			else if (leading.insert(sit->first).second) pending.push_back(sit->first);
+		}
+	}
+	while (!pending.empty())
+	{
+		std::vector<unsigned int> &from = referrers[pending.back()];
+		pending.pop_back();
+		for (size_t i=0; i<from.size(); ++i)
+		{
+			if (leading.insert(from[i]).second) pending.push_back(from[i]);
+		}
+	}
+	for (sit = scanned.begin(); sit != send; ++sit)
+	{
+		if (!leading.count(sit->first)) continue;
+
+		refs.clear();
+		for (size_t i=0; i<sit->second.size(); ++i)
+		{
+			unsigned int ref = sit->second[i];
+			if (store->getObject(ref) || leading.count(ref)) refs.push_back(ref);
+		}
+		store->setRefs(sit->first, refs);
+	}
+
+	if (store->proxies > 0) lazy_records = store;
+}
+
+void CLContext::materialize(CLCollectable *obj)
+{
+	assert(obj->save_lazy && lazy_records);
+	obj->save_lazy = false;
+
+	std::shared_ptr<CLRecordStore> store = lazy_records;
+	const std::string *data = store->find(obj->save_id);
+	if (!data) throw std::runtime_error("Invalid savegame: missing object record");
+
+	std::istringstream none;
+	CLSerialLoader S(none, this);
+	S.setRecordStore(store);
+	S.setLazy(true);
+	S.pushInput(*data);
+
+	int type;
+	S.IO(type);
+	S.addPtr(obj);
+	if (type == CL_RAW_TABLE) CLTable::loadInPlace(S, static_cast<CLTable*>(obj));
+	else CLArray::loadInPlace(S, static_cast<CLArray*>(obj));
+
+	S.popInput();
+	store->remove(obj->save_id);
+	obj->save_dirty = false; // still as it was saved
+
+	if (--store->proxies == 0) lazy_records.reset();
+}
+
+void CLContext::materializeAll()
+{
+	while (lazy_records) // (materializing may add proxies)
+	{
+		std::vector<CLObject*> proxies;
+		std::unordered_map<unsigned int, CLObject*>::const_iterator it = lazy_records->getObjects().begin(), end = lazy_records->getObjects().end();
+		for (; it!=end; ++it)
+		{
+			if (it->second->save_lazy) proxies.push_back(it->second);
+		}
+
+		for (size_t i=0; i<proxies.size(); ++i) proxies[i]->materialize();
+	}
+}
+
+void CLContext::markRecordRefs(CLCollectable *obj)
+{
+	// A proxy keeps the objects its record refers to, directly or through the records of
+	// tables and arrays that aren't loaded yet (they become proxies when it's materialized)
+	if (!lazy_records) return;
+
+	std::set<unsigned int> seen;
+	std::vector<unsigned int> pending(1, obj->save_id);
+	while (!pending.empty())
+	{
+		const std::vector<unsigned int> *refs = lazy_records->getRefs(pending.back());
+		pending.pop_back();
+		if (!refs) continue;
+
+		for (size_t i=0; i<refs->size(); ++i)
+		{
+			CLObject *ref = lazy_records->getObject((*refs)[i]);
+			if (ref) ref->mark();
+			else if (seen.insert((*refs)[i]).second) pending.push_back((*refs)[i]);
+		}
+	}
+}
+
+void CLContext::resetSaveIds()
+{
+	for (CLCollectable *it = gc_heap_list; it; it = it->next) it->save_id = 0;
+	next_save_id = 1;
+	deleted_save_ids.clear();
+}
+
+void CLContext::saveQueue(CLSerialSaver &S, CLThreadQueue &queue)
+{
+	unsigned int tmp;
+	S.IO(tmp = queue.size());
+	for (CLThread *t = queue.front(); t; t = t->queue_next) CLValue::save(S, CLValue(t));
+}
+
+void CLContext::loadQueue(CLSerialLoader &S, CLThreadQueue &queue)
+{
+	unsigned int tmp;
+	S.IO(tmp);
+	for (unsigned i=0; i<tmp; ++i)
+	{
+		CLValue thr = CLValue::load(S);
+		if ((thr.type != CL_THREAD) || (GET_THREAD(thr)->queue != &queue)) throw std::runtime_error("Invalid context: thread is not in queue");
+
+		// move to back in saved order
+		queue.remove(GET_THREAD(thr));
+		queue.push(GET_THREAD(thr));
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -220,12 +697,16 @@ void CLContext::markObjects()
 	// mark root table
 	root_table.markObject();
 
-	// mark all running threads
-	std::list<CLValue>::iterator it = threads.begin(), end = threads.end();
-	for (;it!=end;++it) 
+	// mark all running threads (blocked ones, too) and pooled threads
+	for (CLThread *t = threads; t; t = t->all_next)
 	{
-		if (GET_THREAD(*it)->isRunning()) it->markObject();
+		if (t->isRunning() || (t->queue == &thread_pool)) CLValue(t).markObject();
 	}
+	if (call_thread) CLValue(call_thread).markObject();
+
+	// mark futures of unfinished jobs
+	std::map<unsigned long, CLValue>::iterator it = jobs.begin(), end = jobs.end();
+	for (;it!=end;++it) it->second.markObject();
 }
 
 void CLContext::sweepObjects()
@@ -300,12 +781,24 @@ void CLContext::finalizeObjects()
 	while (it)
 	{
 		CLCollectable *obj = it; it = it->next;
+		if (obj->save_id) deleted_save_ids.push_back(obj->save_id);
+		if (obj->save_id && lazy_records) dropRecord(obj);
 		delete obj;
 	}
 
 	gc_finalize_list = 0;
 }
 
+void CLContext::dropRecord(CLCollectable *obj)
+{
+	// nothing that is still loaded refers to the object (or the proxy's record)
+	lazy_records->removeObject(obj->save_id);
+	if (!obj->save_lazy) return;
+
+	lazy_records->remove(obj->save_id);
+	if (--lazy_records->proxies == 0) lazy_records.reset();
+}
+
 void CLContext::unmarkObjects()
 {
 	CLCollectable *it = gc_heap_list;
@@ -25,9 +25,14 @@
 #include "clthread.h"
 #include "clmodule.h"
 #include "clsysmodule.h"
+#include "cltimerwheel.h"
+#include "clworkers.h"
 
 #include <list>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 class CLContext
 {
@@ -38,17 +43,63 @@ public:
 	inline CLValue &getRootTable() { return root_table; }
 
 	int countRunningThreads();
-	void roundRobin(int timeout = -1);
+	bool hasReadyThreads();
+
+	// Synchronous call: run fn to completion on the context's call thread and return its result.
+	// May be nested (e.g. from external functions of a called function). fn may not yield or wait.
+	CLValue call(CLValue fn, CLValue self = CLValue::Null(), std::vector<CLValue> args = std::vector<CLValue>());
+
+	// Thread pool. newThread returns an uninitialized thread, reusing a recycled one if possible.
+	// recycleThread hands back a finished thread that nothing but the caller refers to.
+	CLValue newThread();
+	void recycleThread(CLValue thread);
+	void roundRobin(int timeout = -1); // resume each ready thread once
+
+	// Resume ready threads by priority class until each has yielded or blocked once, or until
+	// budget microseconds have passed. Threads are run in slices of 'slice' instructions (loop
+	// iterations in native code), so a long running thread is preempted and continues first
+	// in the next call.
+	void schedule(long budget, int slice = 1000);
+
+	// Blocking waits (see CLThread::join, waitSignal, sleep)
+	int signal(const std::string &name, CLValue value = CLValue::Null()); // wake all waiting threads, return their number
+	void tick(unsigned long ms);        // advance clock, wake sleeping threads
+	unsigned long getClock() { return timers.getTime(); }
+
+	// Asynchronous native work. async() runs job in a worker thread and returns a future
+	// (CL_FUTURE) for its result; the host delivers the results of finished jobs with
+	// completeJobs() at a defined point of its frame.
+	CLValue async(CLWorkerPool::Job job, unsigned long *id = 0);
+	CLValue asyncThread(CLWorkerPool::Job job); // same, in a thread of its own (for jobs that may block)
+	int completeJobs();                 // complete futures of finished jobs, return their number
+	void waitJobs();                    // wait for all jobs, then complete their futures
+	void waitJob(unsigned long id);     // wait for one job (see async), then complete the futures finished so far
+	bool jobsCancelled() { return workers.isCancelled(); } // the context is being cleared, jobs should stop
 
 	// Modules
 	void addModule(CLModule *module);
 	CLExternalFunctionPtr getExternalFunctionPtr(const std::string &func_id);
+	CLNativeFunctionPtr getNativeFunctionPtr(unsigned long long hash);
 
 	// Save, Load, Clear complete context
 	void clear();
 	void save(class CLSerialSaver &S);
 	void load(class CLSerialLoader &S);
 
+	// Delta saves (see CLSerialSaver::Mode). After the roots (save), saveRecords writes the
+	// objects queued by the saver; loadRecords reads them into the loader before load.
+	void saveRecords(class CLSerialSaver &S);
+	void loadRecords(class CLSerialLoader &S);
+	unsigned int newSaveId() { return next_save_id++; }
+
+	// Lazy loading (see CLSerialLoader::setLazy). After load, finishLoad loads the records
+	// that can't wait (userdata, functions, threads..) and keeps the others for the proxies,
+	// which call materialize on first access.
+	void finishLoad(class CLSerialLoader &S);
+	void materialize(CLCollectable *obj);
+	void materializeAll();
+	void markRecordRefs(CLCollectable *obj); // (GC) the objects a proxy's record refers to
+
 	// Convenience functions
 	void addGlobal(const std::string &id, CLValue v);
 	CLValue getGlobal(const std::string &id);
@@ -58,9 +109,33 @@ private:
 
 	// Threads
 	friend class CLThread;
-	void   registerThread(CLValue thread); // Called by CLThread constructor
-	void unregisterThread(CLValue thread); // Called by CLThread destructor
-	std::list<CLValue> threads;
+	void   registerThread(CLThread *thread); // Called by CLThread constructor
+	void unregisterThread(CLThread *thread); // Called by CLThread destructor
+	CLThread *threads;                       // intrusive list of all threads (CLThread::all_next)
+	size_t num_threads;
+
+	// Scheduler
+	CLThreadQueue ready[CLThread::NUM_PRIORITIES];          // running threads that are not blocked
+	std::map<std::string, CLThreadQueue> signal_queues;     // threads waiting for a signal
+	CLTimerWheel timers;                                    // sleeping threads, clock advanced by tick()
+	unsigned sched_round;
+	CLThreadQueue thread_pool;                              // finished threads for reuse
+	CLThread *call_thread;                                  // runs call(), created on demand
+
+	// Jobs
+	CLWorkerPool workers;
+	std::map<unsigned long, CLValue> jobs;                  // futures of unfinished jobs by id
+	unsigned long next_job;
+
+	void saveQueue(class CLSerialSaver &S, CLThreadQueue &queue);
+	void loadQueue(class CLSerialLoader &S, CLThreadQueue &queue);
+
+	// Save chain
+	unsigned int next_save_id;
+	std::vector<unsigned int> deleted_save_ids;             // saved objects freed since the last save
+	std::shared_ptr<class CLRecordStore> lazy_records;      // records of proxies not loaded yet
+	void resetSaveIds();
+	void dropRecord(CLCollectable *obj);                    // of a freed object
 
 	// Modules
 	std::list<CLModule*> modules;
@@ -75,6 +150,7 @@ private:
 	void moveToFinalizedList(CLCollectable *C); // move object from heap list to finalized list
 	void moveToHeapList(CLCollectable *C);      // move object from finalized list to heap list
 
+protected:
 	// Called by destructor and clear()
 	void shutdown();
 
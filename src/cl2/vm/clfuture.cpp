@@ -0,0 +1,138 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "clfuture.h"
+#include "clcontext.h"
+
+#include "../value/clexternalfunction.h"
+#include "../value/clstring.h"
+
+#include "../serialize/clserialloader.h"
+#include "../serialize/clserialsaver.h"
+
+#include <assert.h>
+
+CLFuture::CLFuture(CLContext *context)
+	: CLObject(context), done(false), failed(false)
+{
+}
+
+CLFuture::~CLFuture()
+{
+	// don't leave threads waiting for a future that's gone
+	while (!waiters.empty()) waiters.front()->wake();
+}
+
+void CLFuture::complete(CLValue value)
+{
+	if (done) return;
+
+	done = true;
+	result = value;
+	touch();
+	while (!waiters.empty()) waiters.front()->wake(result);
+}
+
+void CLFuture::fail(const std::string &err)
+{
+	if (done) return;
+
+	failed = true;
+	error = err;
+	complete(CLValue::Null());
+}
+
+// from CLObject /////////////////////////////////////////////
+
+void CLFuture::set(CLValue &key, CLValue &val)
+{
+}
+
+bool CLFuture::get(CLValue &key, CLValue &val)
+{
+	const std::string &s = GET_STRING(key)->get();
+
+	if (s == "isdone") {
+		val = CLValue(new CLExternalFunction(getContext(), "sys_future_isdone")); return true;
+	} else if (s == "result") {
+		val = this->result; return true;
+	} else if (s == "error") {
+		val = failed ? CLValue(new CLString(getContext(), error)) : CLValue::Null(); return true;
+	}
+
+	return false;
+}
+
+CLValue CLFuture::begin()
+{
+	return CLValue::Null();
+}
+
+CLValue CLFuture::next(CLValue iterator, CLValue &key, CLValue &value)
+{
+	assert(0); // can't happen
+	return CLValue::Null();
+}
+
+std::string CLFuture::toString()
+{
+	if (!done) return "<future: pending>";
+	if (failed) return "<future: failed>";
+	return "<future: " + result.toString() + ">";
+}
+
+// load/save /////////////////////////////////////////////////
+
+CLFuture *CLFuture::load(CLSerialLoader &S)
+{
+	CLFuture *future = new CLFuture(S.getContext()); S.addPtr(future);
+
+	int tmp;
+	S.IO(tmp); future->done = (tmp != 0);
+	S.IO(tmp); future->failed = (tmp != 0);
+	S.IO(future->error);
+	future->result = CLValue::load(S);
+
+	// saved while its job was running: the job is gone, so is the result (threads awaiting it
+	// continue with null, see CLThread::load)
+	if (!future->done)
+	{
+		future->done = true;
+		future->failed = true;
+		future->error = "Job was interrupted by saving the game";
+	}
+	return future;
+}
+
+void CLFuture::save(CLSerialSaver &S, CLFuture *O)
+{
+	int tmp;
+	S.IO(tmp = O->done);
+	S.IO(tmp = O->failed);
+	S.IO(O->error);
+	CLValue::save(S, O->result);
+}
+
+// from CLCollectable ////////////////////////////////////////
+
+void CLFuture::markReferenced()
+{
+	result.markObject();
+}
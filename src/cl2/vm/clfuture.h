@@ -0,0 +1,71 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef CLFUTURE_H
+#define CLFUTURE_H
+
+#include "../value/clobject.h"
+#include "../value/clvalue.h"
+#include "clthread.h"
+
+#include <string>
+
+// A value that is available later, usually the result of native work running in a worker
+// thread (see CLContext::async). Scripts wait for it with sys.await.
+class CLFuture : public CLObject
+{
+public:
+	CLFuture(class CLContext *context);
+	virtual ~CLFuture();
+
+	bool isDone() { return done; }
+	bool isFailed() { return failed; }
+	CLValue getResult() { return result; }
+	const std::string &getError() { return error; }
+
+	// Done; waiting threads are woken with the result (null on failure)
+	void complete(CLValue value);
+	void fail(const std::string &err);
+
+	// from CLObject
+	virtual void set(CLValue &key, CLValue &val);
+	virtual bool get(CLValue &key, CLValue &val);
+	virtual CLValue begin();
+	virtual CLValue next(CLValue iterator, CLValue &key, CLValue &value);
+	virtual std::string toString();
+
+	// load/save
+	static CLFuture *load(class CLSerialLoader &S);
+	static void save(class CLSerialSaver &S, CLFuture *O);
+
+	// from CLCollectable
+	virtual void markReferenced();
+
+private:
+	bool done;
+	bool failed;
+	CLValue result;
+	std::string error;
+
+	friend class CLThread;
+	CLThreadQueue waiters; // threads blocked in CLThread::await
+};
+
+#endif
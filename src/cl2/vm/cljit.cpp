@@ -0,0 +1,268 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "cljit.h"
+#include "clnativeops.h"
+
+#include <vector>
+#include <cstring>
+#include <exception>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(_WIN32)
+#define CLJIT_X86_64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+bool CLJit::enabled = true;
+unsigned CLJit::threshold = 50;
+
+// native code of one function
+struct CLJitCode
+{
+	unsigned char *mem;          // executable memory
+	size_t size;                 // size of 'mem'
+	std::vector<unsigned> entry; // code offset of each instruction
+};
+
+// signature of the generated code: first argument is the thread, second one the
+// address to start at.
+typedef int (*CLJitEntry)(CLThread *thread, unsigned char *start);
+
+////////////////////////////////////////////////////////////////////////////////
+// x86-64 code emitter                                                        //
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef CLJIT_X86_64
+
+// exception of the helper that made the native code exit with THROWN
+static thread_local std::exception_ptr thrown;
+
+static int guard(CLThread *thread, void *arg, CLNativeHelper helper)
+{
+	try
+	{
+		return helper(thread, arg);
+	}
+	catch (...)
+	{
+		thrown = std::current_exception();
+		return CLJit::THROWN;
+	}
+}
+
+class CLJitAssembler
+{
+public:
+	size_t pos() { return buf.size(); }
+	const std::vector<unsigned char> &code() { return buf; }
+
+	void emit(unsigned char b) { buf.push_back(b); }
+	void emit(unsigned char b0, unsigned char b1) { emit(b0); emit(b1); }
+	void emit(unsigned char b0, unsigned char b1, unsigned char b2) { emit(b0); emit(b1); emit(b2); }
+	void emit32(int v)   { for (int i=0; i<4; ++i) emit((unsigned char)(v >> (i*8))); }
+	void emit64(const void *p) { unsigned long long v = (unsigned long long)p; for (int i=0; i<8; ++i) emit((unsigned char)(v >> (i*8))); }
+	void patch32(size_t at, int v) { for (int i=0; i<4; ++i) buf[at+i] = (unsigned char)(v >> (i*8)); }
+
+	// guard(thread, arg, helper) with thread kept in rbx
+	void callHelper(CLNativeHelper helper, const void *arg)
+	{
+		emit(0x48, 0x89, 0xDF);           // mov rdi, rbx
+		emit(0x48, 0xBE); emit64(arg);    // mov rsi, imm64
+		emit(0x48, 0xBA); emit64((const void*)helper); // mov rdx, imm64
+		emit(0x48, 0xB8); emit64((const void*)&guard); // mov rax, imm64
+		emit(0xFF, 0xD0);                 // call rax
+	}
+
+	void testResult() { emit(0x85, 0xC0); }  // test eax, eax
+	void testThrown() { emit(0x83, 0xF8, CLJit::THROWN); } // cmp eax, THROWN
+
+	// jumps with rel32 displacement; return position of the displacement
+	size_t jmp() { emit(0xE9); emit32(0); return pos()-4; }
+	size_t jnz() { emit(0x0F, 0x85); emit32(0); return pos()-4; }
+	size_t jz()  { emit(0x0F, 0x84); emit32(0); return pos()-4; }
+
+	void bind(size_t disp_at, size_t target) { patch32(disp_at, int(target) - int(disp_at + 4)); }
+
+private:
+	std::vector<unsigned char> buf;
+};
+
+bool CLJit::isAvailable()
+{
+	return true;
+}
+
+bool CLJit::compile(CLFunction *fn)
+{
+	if (!enabled || fn->jit_code || fn->code.empty()) return false;
+
+	// all opcodes known?
+	size_t n = fn->code.size();
+	for (size_t i=0; i<n; ++i) if (!getNativeOpDesc(fn->code[i].op)) return false;
+
+	CLJitAssembler a;
+
+	// prologue: keep thread in rbx (which also aligns the stack), jump to start address
+	a.emit(0x53);                     // push rbx
+	a.emit(0x48, 0x89, 0xFB);         // mov rbx, rdi
+	a.emit(0xFF, 0xE6);               // jmp rsi
+
+	// epilogue: exit code is in eax
+	size_t epilogue = a.pos();
+	a.emit(0x5B);                     // pop rbx
+	a.emit(0xC3);                     // ret
+
+	struct Fixup { size_t at; unsigned target; };
+	std::vector<Fixup> fixups;
+	std::vector<unsigned> entry(n);
+
+	for (unsigned i=0; i<n; ++i)
+	{
+		CLInstruction *inst = &fn->code[i];
+		const CLNativeOpDesc *t = getNativeOpDesc(inst->op);
+		entry[i] = unsigned(a.pos());
+
+		const void *arg = inst;
+		if (inst->op == OP_PUSHCONST) arg = &fn->constants[inst->arg];
+
+		switch (t->kind)
+		{
+			case NATIVE_NONE: break;
+
+			case NATIVE_PLAIN:
+				a.callHelper(t->helper, arg);
+				a.testThrown();
+				a.bind(a.jz(), epilogue);
+				break;
+
+			case NATIVE_EXIT: // (THROWN exits, too)
+				a.callHelper(t->helper, arg);
+				a.testResult();
+				a.bind(a.jnz(), epilogue);
+				break;
+
+			case NATIVE_BRANCH:
+			case NATIVE_JUMP:
+			{
+				unsigned target = unsigned(inst->arg);
+				if (target >= n) return false; // invalid jump target
+
+				size_t skip = 0;
+				if (t->kind == NATIVE_BRANCH)
+				{
+					a.callHelper(t->helper, arg);
+					a.testThrown();
+					a.bind(a.jz(), epilogue);
+					a.testResult();
+					if (target > i) // forward: plain conditional jump
+					{
+						Fixup f = { a.jnz(), target }; fixups.push_back(f);
+						break;
+					}
+					skip = a.jz();
+				} else if (target > i) {
+					Fixup f = { a.jmp(), target }; fixups.push_back(f);
+					break;
+				}
+
+				// backward: possibly suspend before jumping (timeout)
+				a.callHelper(&CLNativeOps::backedge, &fn->code[target]);
+				a.testResult();
+				a.bind(a.jnz(), epilogue);
+				a.bind(a.jmp(), entry[target]);
+
+				if (skip) a.bind(skip, a.pos());
+				break;
+			}
+		}
+	}
+
+	// running past the last instruction can't happen (there's always a return)
+	a.emit(0x0F, 0x0B);               // ud2
+
+	for (size_t i=0; i<fixups.size(); ++i) a.bind(fixups[i].at, entry[fixups[i].target]);
+
+	// copy to executable memory
+	size_t page = size_t(sysconf(_SC_PAGESIZE));
+	size_t size = ((a.pos() + page - 1) / page) * page;
+	void *mem = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED) return false;
+
+	memcpy(mem, &a.code()[0], a.pos());
+	if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0)
+	{
+		munmap(mem, size);
+		return false;
+	}
+
+	CLJitCode *jc = new CLJitCode;
+	jc->mem = static_cast<unsigned char*>(mem);
+	jc->size = size;
+	jc->entry.swap(entry);
+	fn->jit_code = jc;
+	return true;
+}
+
+void CLJit::release(CLFunction *fn)
+{
+	if (!fn->jit_code) return;
+
+	munmap(fn->jit_code->mem, fn->jit_code->size);
+	delete fn->jit_code;
+	fn->jit_code = 0;
+}
+
+int CLJit::execute(CLThread *thread, CLFunction *fn, unsigned ip)
+{
+	CLJitCode *jc = fn->jit_code;
+	CLJitEntry code = reinterpret_cast<CLJitEntry>(jc->mem);
+	int exit_code = code(thread, jc->mem + jc->entry[ip]);
+	if (exit_code == THROWN)
+	{
+		std::exception_ptr e = thrown;
+		thrown = nullptr;
+		std::rethrow_exception(e);
+	}
+	return exit_code;
+}
+
+#else // no code generator for this platform
+
+bool CLJit::isAvailable()
+{
+	return false;
+}
+
+bool CLJit::compile(CLFunction *fn)
+{
+	return false;
+}
+
+void CLJit::release(CLFunction *fn)
+{
+}
+
+int CLJit::execute(CLThread *thread, CLFunction *fn, unsigned ip)
+{
+	return REDISPATCH;
+}
+
+#endif
@@ -0,0 +1,69 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef CLJIT_H
+#define CLJIT_H
+
+class CLThread;
+class CLFunction;
+
+// Baseline template JIT for x86-64.
+//
+// Each instruction of a hot CLFunction is translated into a small code template
+// that calls a helper operating on the thread's stack and locals. Dispatch, 
+// instruction fetch and jumps are native, the frame state itself stays in the
+// CLThread's CallInfo. Native code is left at every call, return and yield, 
+// so the interpreter can take over at any instruction boundary and threads can
+// be saved/loaded no matter how their functions were executed.
+// The generated code has no unwind info, so exceptions must not pass through
+// it: helpers are called through a guard that catches them, the code exits
+// and execute rethrows them.
+
+class CLJit
+{
+public:
+	enum ExitCode
+	{
+		CONTINUE   = 0, // (internal) go on with the next instruction
+		REDISPATCH = 1, // callstack or thread state changed, pick up the current frame again
+		SUSPEND    = 2, // thread yielded or ran out of time
+		THROWN     = 3  // (internal) a helper threw, execute rethrows the exception
+	};
+
+	static bool isAvailable(); // false if there's no code generator for this platform
+
+	static void setEnabled(bool yes) { enabled = yes; }
+	static bool isEnabled() { return enabled; }
+
+	static void setThreshold(unsigned calls) { threshold = calls; } // number of calls before compiling
+	static unsigned getThreshold() { return threshold; }
+
+	static bool compile(CLFunction *fn); // returns false if fn was not compiled
+	static void release(CLFunction *fn); // free native code of fn (if any)
+
+	// run native code of fn, starting at instruction ip of the current frame
+	static int execute(CLThread *thread, CLFunction *fn, unsigned ip);
+
+private:
+	static bool enabled;
+	static unsigned threshold;
+};
+
+#endif
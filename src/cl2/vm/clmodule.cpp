@@ -46,6 +46,11 @@ CLExternalFunctionPtr CLModule::getExternalFunctionPtr(const std::string &ident)
 	return 0;
 }
 
+CLNativeFunctionPtr CLModule::getNativeFunctionPtr(unsigned long long hash)
+{
+	return 0;
+}
+
 void CLModule::registerFunction(std::string name, std::string id, CLExternalFunctionPtr func)
 {
 	reg_funcs.push_back(RegisteredFunction(name, id, func));
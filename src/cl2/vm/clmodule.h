@@ -31,6 +31,7 @@ class CLModule;
 class CLContext;
 
 typedef CLValue (*CLExternalFunctionPtr)(CLThread &thread, std::vector<CLValue> &args, CLValue self);
+typedef int (*CLNativeFunctionPtr)(CLThread *thread); // native implementation of a script function, see CLTranslator
 
 class CLModule
 {
@@ -41,6 +42,7 @@ public:
 	const std::string &getName() { return this->name; }
 
 	virtual CLExternalFunctionPtr getExternalFunctionPtr(const std::string &ident);
+	virtual CLNativeFunctionPtr getNativeFunctionPtr(unsigned long long hash); // by CLFunction::getHash()
 
 	virtual void init(CLContext *context);
 
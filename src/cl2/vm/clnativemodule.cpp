@@ -0,0 +1,49 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "clnativemodule.h"
+
+CLNativeModule::CLNativeModule(const std::string &name, const Entry *entries, int count) : CLModule(name)
+{
+	for (int i=0; i<count; ++i) funcs[entries[i].hash] = entries[i].func;
+	getRegistered().push_back(this);
+}
+
+CLNativeModule::~CLNativeModule()
+{
+	getRegistered().remove(this);
+}
+
+CLNativeFunctionPtr CLNativeModule::getNativeFunctionPtr(unsigned long long hash)
+{
+	std::map<unsigned long long, CLNativeFunctionPtr>::iterator it = funcs.find(hash);
+	return it != funcs.end() ? it->second : 0;
+}
+
+void CLNativeModule::init(CLContext *context)
+{
+}
+
+//static member
+std::list<CLNativeModule*> &CLNativeModule::getRegistered()
+{
+	static std::list<CLNativeModule*> registered;
+	return registered;
+}
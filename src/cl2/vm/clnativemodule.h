@@ -0,0 +1,54 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef CLNATIVEMODULE_H
+#define CLNATIVEMODULE_H
+
+#include "clmodule.h"
+
+#include <map>
+
+// Native implementations of script functions as generated by CLTranslator.
+// Generated modules are static objects which register themselves, so just
+// linking one into the application adds it to every CLContext created later.
+// Functions compiled from scripts with the same content use the native code.
+class CLNativeModule : public CLModule
+{
+public:
+	struct Entry
+	{
+		unsigned long long hash; // CLFunction::getHash()
+		CLNativeFunctionPtr func;
+	};
+
+	CLNativeModule(const std::string &name, const Entry *entries, int count);
+	virtual ~CLNativeModule();
+
+	virtual CLNativeFunctionPtr getNativeFunctionPtr(unsigned long long hash);
+
+	virtual void init(CLContext *context); // (no namespace table)
+
+	static std::list<CLNativeModule*> &getRegistered();
+
+private:
+	std::map<unsigned long long, CLNativeFunctionPtr> funcs;
+};
+
+#endif
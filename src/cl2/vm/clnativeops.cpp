@@ -0,0 +1,103 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "clnativeops.h"
+
+static CLNativeOpDesc nativeopdesc[] =
+{
+	{OP_NOP,          NATIVE_NONE,   0,                           0},
+
+	{OP_PUSH0,        NATIVE_PLAIN,  &CLNativeOps::push0,         "push0"},
+	{OP_PUSHROOT,     NATIVE_PLAIN,  &CLNativeOps::pushroot,      "pushroot"},
+	{OP_PUSHSELF,     NATIVE_PLAIN,  &CLNativeOps::pushself,      "pushself"},
+	{OP_PUSHCONST,    NATIVE_PLAIN,  &CLNativeOps::pushconst,     "pushconst"},
+	{OP_PUSHEXTFUNC,  NATIVE_PLAIN,  &CLNativeOps::pushextfunc,   "pushextfunc"},
+	{OP_PUSHI,        NATIVE_PLAIN,  &CLNativeOps::pushi,         "pushi"},
+	{OP_PUSHF,        NATIVE_PLAIN,  &CLNativeOps::pushf,         "pushf"},
+	{OP_PUSHS,        NATIVE_PLAIN,  &CLNativeOps::pushs,         "pushs"},
+	{OP_PUSHB,        NATIVE_PLAIN,  &CLNativeOps::pushb,         "pushb"},
+	{OP_POP,          NATIVE_PLAIN,  &CLNativeOps::pop,           "pop"},
+	{OP_DUP,          NATIVE_PLAIN,  &CLNativeOps::dup,           "dup"},
+
+	{OP_NEWTABLE,     NATIVE_PLAIN,  &CLNativeOps::newtable,      "newtable"},
+	{OP_NEWARRAY,     NATIVE_PLAIN,  &CLNativeOps::newarray,      "newarray"},
+	{OP_TABGET,       NATIVE_EXIT,   &CLNativeOps::tabget,        "tabget"},
+	{OP_TABGET2,      NATIVE_EXIT,   &CLNativeOps::tabget2,       "tabget2"},
+	{OP_TABSET,       NATIVE_EXIT,   &CLNativeOps::tabset,        "tabset"},
+	{OP_TABIT,        NATIVE_EXIT,   &CLNativeOps::tabit,         "tabit"},
+	{OP_TABNEXT,      NATIVE_EXIT,   &CLNativeOps::tabnext,       "tabnext"},
+	{OP_CLONE,        NATIVE_PLAIN,  &CLNativeOps::clone,         "clone"},
+
+	{OP_PUSHL,        NATIVE_PLAIN,  &CLNativeOps::pushl,         "pushl"},
+	{OP_POPL,         NATIVE_PLAIN,  &CLNativeOps::popl,          "popl"},
+	{OP_ADDL,         NATIVE_PLAIN,  &CLNativeOps::addl,          "addl"},
+	{OP_DELL,         NATIVE_PLAIN,  &CLNativeOps::dell,          "dell"},
+
+	{OP_ADD,          NATIVE_PLAIN,  &CLNativeOps::add,           "add"},
+	{OP_SUB,          NATIVE_PLAIN,  &CLNativeOps::sub,           "sub"},
+	{OP_MUL,          NATIVE_PLAIN,  &CLNativeOps::mul,           "mul"},
+	{OP_DIV,          NATIVE_PLAIN,  &CLNativeOps::div,           "div"},
+	{OP_MODULO,       NATIVE_PLAIN,  &CLNativeOps::modulo,        "modulo"},
+	{OP_NEG,          NATIVE_PLAIN,  &CLNativeOps::neg,           "neg"},
+
+	{OP_BITOR,        NATIVE_PLAIN,  &CLNativeOps::bitor_,        "bitor_"},
+	{OP_BITAND,       NATIVE_PLAIN,  &CLNativeOps::bitand_,       "bitand_"},
+	{OP_BITXOR,       NATIVE_PLAIN,  &CLNativeOps::bitxor,        "bitxor"},
+	{OP_SHL,          NATIVE_PLAIN,  &CLNativeOps::shl,           "shl"},
+	{OP_SHR,          NATIVE_PLAIN,  &CLNativeOps::shr,           "shr"},
+
+	{OP_AND,          NATIVE_PLAIN,  &CLNativeOps::and_,          "and_"},
+	{OP_OR,           NATIVE_PLAIN,  &CLNativeOps::or_,           "or_"},
+	{OP_NOT,          NATIVE_PLAIN,  &CLNativeOps::not_,          "not_"},
+
+	{OP_EQ,           NATIVE_PLAIN,  &CLNativeOps::eq,            "eq"},
+	{OP_NEQ,          NATIVE_PLAIN,  &CLNativeOps::neq,           "neq"},
+	{OP_LT,           NATIVE_PLAIN,  &CLNativeOps::lt,            "lt"},
+	{OP_GT,           NATIVE_PLAIN,  &CLNativeOps::gt,            "gt"},
+	{OP_LE,           NATIVE_PLAIN,  &CLNativeOps::le,            "le"},
+	{OP_GE,           NATIVE_PLAIN,  &CLNativeOps::ge,            "ge"},
+
+	{OP_MCALL,        NATIVE_EXIT,   &CLNativeOps::mcall,         "mcall"},
+	{OP_TAILCALL,     NATIVE_EXIT,   &CLNativeOps::tailcall,      "tailcall"},
+	{OP_RET,          NATIVE_EXIT,   &CLNativeOps::ret,           "ret"},
+	{OP_YIELD,        NATIVE_EXIT,   &CLNativeOps::yield,         "yield"},
+
+	{OP_JMP,          NATIVE_JUMP,   0,                           0},
+	{OP_JMPT,         NATIVE_BRANCH, &CLNativeOps::jmpt,          "jmpt"},
+	{OP_JMPF,         NATIVE_BRANCH, &CLNativeOps::jmpf,          "jmpf"},
+	{OP_JMP0,         NATIVE_BRANCH, &CLNativeOps::jmp0,          "jmp0"},
+
+	{OP_FILE,         NATIVE_PLAIN,  &CLNativeOps::file,          "file"},
+	{OP_LINE,         NATIVE_PLAIN,  &CLNativeOps::line,          "line"},
+
+	{OP_RANGEPREP,    NATIVE_BRANCH, &CLNativeOps::rangeprep,     "rangeprep"},
+	{OP_RANGELOOP,    NATIVE_BRANCH, &CLNativeOps::rangeloop,     "rangeloop"},
+	{OP_TABLOOP,      NATIVE_BRANCH, &CLNativeOps::tabloop,       "tabloop"}
+};
+static const int num_nativeopdesc = sizeof(nativeopdesc) / sizeof(CLNativeOpDesc);
+
+const CLNativeOpDesc *getNativeOpDesc(CLOpcode op)
+{
+	for (int i=0; i<num_nativeopdesc; ++i)
+	{
+		if (op == nativeopdesc[i].op) return &nativeopdesc[i];
+	}
+	return 0;
+}
@@ -0,0 +1,232 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef CLNATIVEOPS_H
+#define CLNATIVEOPS_H
+
+#include "cljit.h"
+#include "clthread.h"
+#include "clcontext.h"
+
+#include "../value/clfunction.h"
+#include "../value/clexternalfunction.h"
+#include "../value/clstring.h"
+#include "../value/cltable.h"
+#include "../value/clarray.h"
+
+// Instructions for native code, used by the JIT (see cljit.cpp) and by C++ code
+// generated by CLTranslator. They operate on the current frame of the thread.
+// Helpers of instructions that can't leave native code return CONTINUE, others
+// return a CLJit::ExitCode. Branch helpers return 1 if the branch is taken.
+typedef int (*CLNativeHelper)(CLThread *thread, void *arg);
+
+#define CLNATIVE_INST(arg) (static_cast<CLInstruction*>(arg))
+
+struct CLNativeOps
+{
+	// current frame
+	static CLFunction *function(CLThread *t)      { return GET_FUNCTION(t->callstackTop().func); }
+	static unsigned ip(CLThread *t)               { return t->callstackTop().ip; }
+
+	// set instruction pointer of current frame to the instruction following 'inst'
+	static void setNextIP(CLThread *t, CLInstruction *inst)
+	{
+		CLThread::CallInfo &ci = t->callstackTop();
+		ci.ip = unsigned(inst - &GET_FUNCTION(ci.func)->code[0]) + 1;
+	}
+
+	// Push constants to stack/pop stack/duplicate stack
+	static int push0(CLThread *t, void *)         { t->stackPush(CLValue()); return CLJit::CONTINUE; }
+	static int pushroot(CLThread *t, void *)      { t->stackPush(t->getContext()->getRootTable()); return CLJit::CONTINUE; }
+	static int pushself(CLThread *t, void *)      { t->stackPush(t->callstackTop().self); return CLJit::CONTINUE; }
+	static int pushconst(CLThread *t, void *v)    { t->stackPush(*static_cast<CLValue*>(v)); return CLJit::CONTINUE; }
+	static int pushextfunc(CLThread *t, void *a)  { t->stackPush(CLValue(new CLExternalFunction(t->getContext(), CLNATIVE_INST(a)->arg_str))); return CLJit::CONTINUE; }
+	static int pushi(CLThread *t, void *a)        { t->stackPush(CLValue(CLNATIVE_INST(a)->arg)); return CLJit::CONTINUE; }
+	static int pushf(CLThread *t, void *a)        { t->stackPush(CLValue(CLNATIVE_INST(a)->arg_float)); return CLJit::CONTINUE; }
+	static int pushs(CLThread *t, void *a)        { t->stackPush(CLValue(new CLString(t->getContext(), CLNATIVE_INST(a)->arg_str))); return CLJit::CONTINUE; }
+	static int pushb(CLThread *t, void *a)        { t->stackPush(CLNATIVE_INST(a)->arg == 0 ? CLValue::False() : CLValue::True()); return CLJit::CONTINUE; }
+	static int pop(CLThread *t, void *a)          { for (int i=0; i<CLNATIVE_INST(a)->arg; ++i) t->stackPop(); return CLJit::CONTINUE; }
+	static int dup(CLThread *t, void *a)          { t->stackDup(CLNATIVE_INST(a)->arg); return CLJit::CONTINUE; }
+
+	// Local variables
+	static int pushl(CLThread *t, void *a)        { t->stackPush(t->callstackTop().locals[CLNATIVE_INST(a)->arg]); return CLJit::CONTINUE; }
+	static int popl(CLThread *t, void *a)         { t->callstackTop().locals[CLNATIVE_INST(a)->arg] = t->stackPop(); return CLJit::CONTINUE; }
+	static int addl(CLThread *t, void *a)
+	{
+		std::vector<CLValue> &locals = t->callstackTop().locals;
+		locals.resize(locals.size() + CLNATIVE_INST(a)->arg, CLValue(12345678));
+		return CLJit::CONTINUE;
+	}
+	static int dell(CLThread *t, void *a)
+	{
+		std::vector<CLValue> &locals = t->callstackTop().locals;
+		locals.erase(locals.end() - CLNATIVE_INST(a)->arg, locals.end());
+		return CLJit::CONTINUE;
+	}
+
+	// Operations
+#define BINARY_OP(name, m) static int name(CLThread *t, void *) { CLValue op2 = t->stackPop(); CLValue op1 = t->stackPop(); t->stackPush(op1.m(op2)); return CLJit::CONTINUE; }
+#define UNARY_OP(name, m)  static int name(CLThread *t, void *) { t->stackPush(t->stackPop().m()); return CLJit::CONTINUE; }
+	UNARY_OP (neg,    op_neg)
+	BINARY_OP(add,    op_add)
+	BINARY_OP(sub,    op_sub)
+	BINARY_OP(mul,    op_mul)
+	BINARY_OP(div,    op_div)
+	BINARY_OP(shl,    op_shl)
+	BINARY_OP(shr,    op_shr)
+	BINARY_OP(modulo, op_modulo)
+	BINARY_OP(bitor_, op_bitor)
+	BINARY_OP(bitand_,op_bitand)
+	BINARY_OP(bitxor, op_bitxor)
+	BINARY_OP(and_,   op_booland)
+	BINARY_OP(or_,    op_boolor)
+	UNARY_OP (not_,   op_boolnot)
+	BINARY_OP(eq,     op_eq)
+	BINARY_OP(lt,     op_lt)
+	BINARY_OP(gt,     op_gt)
+	BINARY_OP(le,     op_le)
+	BINARY_OP(ge,     op_ge)
+#undef UNARY_OP
+#undef BINARY_OP
+	static int neq(CLThread *t, void *)           { t->stackPush(t->stackPop().op_eq(t->stackPop()).op_boolnot()); return CLJit::CONTINUE; }
+
+	// Table/Array constructor, Get/Set/Iterator operations, Clone operator
+	static int newtable(CLThread *t, void *)      { t->stackPush(CLValue(new CLTable(t->getContext()))); return CLJit::CONTINUE; }
+	static int newarray(CLThread *t, void *)      { t->stackPush(CLValue(new CLArray(t->getContext()))); return CLJit::CONTINUE; }
+	static int tabset(CLThread *t, void *)        { return t->op_tabset() ? CLJit::CONTINUE : CLJit::REDISPATCH; }
+	static int tabget(CLThread *t, void *)        { return t->op_tabget(false) ? CLJit::CONTINUE : CLJit::REDISPATCH; }
+	static int tabget2(CLThread *t, void *)       { return t->op_tabget(true) ? CLJit::CONTINUE : CLJit::REDISPATCH; }
+	static int tabit(CLThread *t, void *)         { return t->op_tabit() ? CLJit::CONTINUE : CLJit::REDISPATCH; }
+	static int tabnext(CLThread *t, void *)       { return t->op_tabnext() ? CLJit::CONTINUE : CLJit::REDISPATCH; }
+	static int clone(CLThread *t, void *)         { t->stackPush(t->stackPop().clone()); return CLJit::CONTINUE; }
+
+	// Inline forms for C++ code generated by CLTranslator: the argument is a constant of the
+	// generated code, and integer operands take a fast path without calling CLValue
+	static void pushi_n(CLThread *t, int i)       { t->stackPush(CLValue(i)); }
+	static void pushb_n(CLThread *t, bool b)      { t->stackPush(b ? CLValue::True() : CLValue::False()); }
+	static void pop_n(CLThread *t, int n)         { t->sp -= n; }
+	static void dup_n(CLThread *t, int offset)    { t->stackDup(offset); }
+	static void pushl_n(CLThread *t, int n)       { t->stackPush(t->callstackTop().locals[n]); }
+	static void popl_n(CLThread *t, int n)        { t->callstackTop().locals[n] = t->stackPop(); }
+
+#define INT_OP(name, op, helper) static void name(CLThread *t) \
+	{ \
+		CLValue &op1 = t->sp[-2], &op2 = t->sp[-1]; \
+		if ((op1.type != CL_INTEGER) || (op2.type != CL_INTEGER)) { helper(t, 0); return; } \
+		op1 = CLValue(op1.getIntUnsave() op op2.getIntUnsave()); \
+		--t->sp; \
+	}
+#define INT_COMPARE(name, op, helper) static void name(CLThread *t) \
+	{ \
+		CLValue &op1 = t->sp[-2], &op2 = t->sp[-1]; \
+		if ((op1.type != CL_INTEGER) || (op2.type != CL_INTEGER)) { helper(t, 0); return; } \
+		op1 = (op1.getIntUnsave() op op2.getIntUnsave()) ? CLValue::True() : CLValue::False(); \
+		--t->sp; \
+	}
+	INT_OP     (add_int, +,  add)
+	INT_OP     (sub_int, -,  sub)
+	INT_OP     (mul_int, *,  mul)
+	INT_COMPARE(lt_int,  <,  lt)
+	INT_COMPARE(gt_int,  >,  gt)
+	INT_COMPARE(le_int,  <=, le)
+	INT_COMPARE(ge_int,  >=, ge)
+#undef INT_COMPARE
+#undef INT_OP
+
+	// Branches (return 1 if taken)
+	static int jmpt(CLThread *t, void *)          { return t->stackPop().toBool() ? 1 : 0; }
+	static int jmpf(CLThread *t, void *)          { return t->stackPop().toBool() ? 0 : 1; }
+	static int jmp0(CLThread *t, void *)          { return t->stackPop().isNull() ? 1 : 0; }
+	static int rangeprep(CLThread *t, void *)     { return t->op_rangeprep() ? 1 : 0; }
+	static int rangeloop(CLThread *t, void *)     { return t->op_rangeloop() ? 1 : 0; }
+	static int tabloop(CLThread *t, void *)       { return t->op_tabloop() ? 1 : 0; }
+
+	// Backward branch to 'target': check timeout
+	static int backedge(CLThread *t, void *target)
+	{
+		if ((t->native_budget == -1) || (0 != t->native_budget--)) return CLJit::CONTINUE;
+
+		CLThread::CallInfo &ci = t->callstackTop();
+		ci.ip = unsigned(CLNATIVE_INST(target) - &GET_FUNCTION(ci.func)->code[0]);
+		t->preempted = true;
+		return CLJit::SUSPEND;
+	}
+
+	// Function call/return/yield
+	static int mcall(CLThread *t, void *a)
+	{
+		setNextIP(t, CLNATIVE_INST(a));
+		size_t depth = t->callstack.size();
+		t->op_mcall();
+
+		// external function calls don't need to leave native code (unless they block the thread)
+		if (t->isRunning() && !t->isBlocked() && (t->callstack.size() == depth)) return CLJit::CONTINUE;
+		return CLJit::REDISPATCH;
+	}
+
+	static int tailcall(CLThread *t, void *)      { t->op_mcall(true); return CLJit::REDISPATCH; }
+	static int ret(CLThread *t, void *)           { t->op_ret(); return CLJit::REDISPATCH; }
+
+	static int yield(CLThread *t, void *a)
+	{
+		t->result = t->stackPop();
+		if (t->call_depth > 0)
+		{
+			t->yieldInCall();
+			return CLJit::SUSPEND;
+		}
+		if (t->do_yield)
+		{
+			setNextIP(t, CLNATIVE_INST(a));
+			return CLJit::SUSPEND;
+		}
+		t->result.setNull();
+		return CLJit::CONTINUE;
+	}
+
+	// Debug info
+	static int file(CLThread *t, void *a)         { t->filename = CLNATIVE_INST(a)->arg_str; return CLJit::CONTINUE; }
+	static int line(CLThread *t, void *a)         { t->linenum = CLNATIVE_INST(a)->arg; return CLJit::CONTINUE; }
+};
+
+#undef CLNATIVE_INST
+
+// How native code implements an instruction
+enum CLNativeOpKind
+{
+	NATIVE_NONE,   // no code at all
+	NATIVE_PLAIN,  // call helper
+	NATIVE_EXIT,   // call helper, leave native code if it returns != CONTINUE
+	NATIVE_BRANCH, // call helper, jump if it returns != 0
+	NATIVE_JUMP    // unconditional jump
+};
+
+struct CLNativeOpDesc
+{
+	CLOpcode op;
+	CLNativeOpKind kind;
+	CLNativeHelper helper;
+	const char *name; // name of helper in CLNativeOps
+};
+
+// returns 0 if there's no native implementation of op
+extern const CLNativeOpDesc *getNativeOpDesc(CLOpcode op);
+
+#endif
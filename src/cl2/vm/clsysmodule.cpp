@@ -21,6 +21,8 @@
 #include "clsysmodule.h"
 #include "clcontext.h"
 #include "clthread.h"
+#include "clfuture.h"
+#include "clworkercontext.h"
 
 #include "../value/clvalue.h"
 #include "../value/clstring.h"
@@ -35,8 +37,18 @@
 static DECL_FUNC(print);
 static DECL_FUNC(println);
 static DECL_FUNC(startthread);
+static DECL_FUNC(currentthread);
 static DECL_FUNC(import); 
 
+// blocking waits
+static DECL_FUNC(wait);
+static DECL_FUNC(waitsignal);
+static DECL_FUNC(signal);
+static DECL_FUNC(sleep);
+static DECL_FUNC(after);
+static DECL_FUNC(await);
+static DECL_FUNC(spawn);
+
 static DECL_FUNC(type_of);
 static DECL_FUNC(has_slot);
 
@@ -49,6 +61,16 @@ static DECL_FUNC(string_replace);
 // thread member functions
 static DECL_FUNC(thread_kill);
 static DECL_FUNC(thread_isrunning);
+static DECL_FUNC(thread_isblocked);
+static DECL_FUNC(thread_join);
+static DECL_FUNC(thread_suspend);
+static DECL_FUNC(thread_resume);
+static DECL_FUNC(thread_setpriority);
+static DECL_FUNC(thread_getpriority);
+static DECL_FUNC(thread_stats);
+
+// future member functions
+static DECL_FUNC(future_isdone);
 
 CLSysModule::CLSysModule() : CLModule("sys")
 {
@@ -56,7 +78,16 @@ CLSysModule::CLSysModule() : CLModule("sys")
 	registerFunction("print",        "sys_print",           &print);
 	registerFunction("println",      "sys_println",         &println);
 	registerFunction("startthread",  "sys_startthread",     &startthread);
+	registerFunction("currentthread","sys_currentthread",   &currentthread);
 	registerFunction("import",       "sys_import",          &import);
+
+	registerFunction("wait",         "sys_wait",            &wait);
+	registerFunction("waitsignal",   "sys_waitsignal",      &waitsignal);
+	registerFunction("signal",       "sys_signal",          &signal);
+	registerFunction("sleep",        "sys_sleep",           &sleep);
+	registerFunction("after",        "sys_after",           &after);
+	registerFunction("await",        "sys_await",           &await);
+	registerFunction("spawn",        "sys_spawn",           &spawn);
 	
 	registerFunction("typeof",       "sys_typeof",          &type_of);
 	registerFunction("has_slot",     "sys_hasslot",         &has_slot);
@@ -70,6 +101,16 @@ CLSysModule::CLSysModule() : CLModule("sys")
 	// thread member functions
 	registerFunction("sys_thread_kill",                     &thread_kill);
 	registerFunction("sys_thread_isrunning",                &thread_isrunning);
+	registerFunction("sys_thread_isblocked",                &thread_isblocked);
+	registerFunction("sys_thread_join",                     &thread_join);
+	registerFunction("sys_thread_suspend",                  &thread_suspend);
+	registerFunction("sys_thread_resume",                   &thread_resume);
+	registerFunction("sys_thread_setpriority",              &thread_setpriority);
+	registerFunction("sys_thread_getpriority",              &thread_getpriority);
+	registerFunction("sys_thread_stats",                    &thread_stats);
+
+	// future member functions
+	registerFunction("sys_future_isdone",                   &future_isdone);
 }
 
 CLSysModule::~CLSysModule()
@@ -103,10 +144,94 @@ static DECL_FUNC(startthread) // startthread(func, arg0, ...argN, self)
 	CLValue func = args[0]; args.erase(args.begin());
 	CLValue self_= args[args.size()-1]; args.pop_back();
 	CLValue result = CLValue(new CLThread(thread.getContext()));
+	GET_THREAD(result)->setPriority(thread.getPriority()); // inherit priority class
 	GET_THREAD(result)->init(func, args, self_);
 	return result;
 }
 
+static DECL_FUNC(currentthread)
+{
+	thread.setShared(); // don't recycle while the script may hold it
+	return CLValue(&thread);
+}
+
+// Blocking waits. The calling thread is not resumed until it is woken; the value it was woken
+// with is the result of the call.
+
+static DECL_FUNC(wait) // wait(thread): wait until thread has finished, return its result
+{
+	if ((args.size() != 1) || (args[0].type != CL_THREAD)) return CLValue::Null();
+
+	CLThread *target = GET_THREAD(args[0]);
+	thread.join(target);
+	return target->getResult();
+}
+
+static DECL_FUNC(waitsignal) // waitsignal(name): wait until name is signalled, return signal value
+{
+	if (args.size() != 1) return CLValue::Null();
+
+	thread.waitSignal(args[0].toString());
+	return CLValue::Null();
+}
+
+static DECL_FUNC(signal) // signal(name[, value]): wake threads waiting for name, return their number
+{
+	if ((args.size() != 1) && (args.size() != 2)) return CLValue(0);
+
+	return CLValue(thread.getContext()->signal(args[0].toString(), args.size() == 2 ? args[1] : CLValue::Null()));
+}
+
+static DECL_FUNC(sleep) // sleep(ms)
+{
+	if ((args.size() != 1) || !args[0].isNumeric()) return CLValue::Null();
+
+	int ms = args[0].toInt();
+	thread.sleep(ms > 0 ? ms : 0);
+	return CLValue::Null();
+}
+
+static DECL_FUNC(after) // after(ms, func, arg0, ...argN, self): start func in a thread after ms, return the thread
+{
+	if ((args.size() < 3) || !args[0].isNumeric()) return CLValue::Null();
+
+	// external functions run as soon as their thread starts, there's nothing to delay
+	if (args[1].type == CL_EXTERNALFUNCTION)
+	{
+		thread.runtimeError("after: can't delay an external function, call it from a script function", false);
+		return CLValue::Null();
+	}
+
+	int ms = args[0].toInt(); args.erase(args.begin());
+	CLValue result = startthread(thread, args, self);
+	GET_THREAD(result)->sleep(ms > 0 ? ms : 0); // kill() cancels the timer
+	return result;
+}
+
+static DECL_FUNC(await) // await(future): wait until future is done, return its result (other values are returned as is)
+{
+	if (args.size() != 1) return CLValue::Null();
+	if (args[0].type != CL_FUTURE) return args[0];
+
+	CLFuture *future = GET_FUTURE(args[0]);
+	thread.await(future);
+	return future->getResult();
+}
+
+static DECL_FUNC(spawn) // spawn(func, arg0, ...argN, self): run func in a worker context, return a future of its result
+{
+	if (args.size() < 2) return CLValue::Null();
+
+	CLValue func = args[0]; args.erase(args.begin());
+	CLValue self_= args[args.size()-1]; args.pop_back();
+	try {
+		return CLWorkerContext::spawn(thread.getContext(), func, args, self_);
+	} catch (std::exception &e) {
+		thread.runtimeError(e.what(), false);
+		return CLValue::Null();
+	}
+}
+
 static DECL_FUNC(import)
 {
 	CLObject *dst = GET_OBJECT(args[0]);
@@ -220,4 +345,74 @@ static DECL_FUNC(thread_isrunning)
 	}
 }
 
+static DECL_FUNC(thread_isblocked)
+{
+	CLThread *thr = GET_THREAD(self);
+	return thr->isBlocked() ? CLValue::True() : CLValue::False();
+}
+
+static DECL_FUNC(thread_join)
+{
+	CLThread *thr = GET_THREAD(self);
+	thread.join(thr);
+	return thr->getResult();
+}
+
+static DECL_FUNC(thread_suspend)
+{
+	CLThread *thr = GET_THREAD(self);
+	return thr->suspend() ? CLValue::True() : CLValue::False();
+}
+
+static DECL_FUNC(thread_resume)
+{
+	CLThread *thr = GET_THREAD(self);
+	return thr->resume() ? CLValue::True() : CLValue::False();
+}
+
+static const char *priority_names[CLThread::NUM_PRIORITIES] = { "input", "gameplay", "background" };
+
+static DECL_FUNC(thread_setpriority) // setpriority("input" | "gameplay" | "background")
+{
+	CLThread *thr = GET_THREAD(self);
+	if (args.size() != 1) return CLValue::False();
+
+	std::string name = args[0].toString();
+	for (int p=0; p<CLThread::NUM_PRIORITIES; ++p)
+	{
+		if (name == priority_names[p])
+		{
+			thr->setPriority(CLThread::Priority(p));
+			return CLValue::True();
+		}
+	}
+	return CLValue::False();
+}
+
+static DECL_FUNC(thread_getpriority)
+{
+	CLThread *thr = GET_THREAD(self);
+	return CLValue(new CLString(thread.getContext(), priority_names[thr->getPriority()]));
+}
+
+static DECL_FUNC(thread_stats) // table of resumes, preemptions, time (total ms), maxtime (ms)
+{
+	CLThread *thr = GET_THREAD(self);
+	const CLThread::Stats &stats = thr->getStats();
+	CLContext *context = thread.getContext();
+
+	CLValue result(new CLTable(context));
+	result.set(CLValue(new CLString(context, "resumes")),     CLValue(int(stats.resumes)));
+	result.set(CLValue(new CLString(context, "preemptions")), CLValue(int(stats.preemptions)));
+	result.set(CLValue(new CLString(context, "time")),        CLValue(float(stats.run_time / 1000.0)));
+	result.set(CLValue(new CLString(context, "maxtime")),     CLValue(float(stats.max_run_time / 1000.0)));
+	return result;
+}
+
+// Future member functions
 
+static DECL_FUNC(future_isdone)
+{
+	CLFuture *future = GET_FUTURE(self);
+	return future->isDone() ? CLValue::True() : CLValue::False();
+}
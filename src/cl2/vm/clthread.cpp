@@ -2,6 +2,8 @@
 #include "clcontext.h"
 #include "clmodule.h"
 #include "clmathmodule.h"
+#include "cljit.h"
+#include "clfuture.h"
 
 #include "../value/clfunction.h"
 #include "../value/clexternalfunction.h"
@@ -15,17 +17,25 @@
 #include <assert.h>
 
 #include <algorithm>
+#include <chrono>
+#include <stdexcept>
 #include <iostream>
 #include <sstream>
 
 using namespace std;
 
 CLThread::CLThread(CLContext *context)
-	: CLObject(context), do_yield(true), state(CLThread::UNINITIALIZED), result(CLValue::Null()), inside_run_method(0), 
+	: CLObject(context), do_yield(true), state(CLThread::UNINITIALIZED), 
+	  wait(WAIT_NONE), wait_result(false), wait_ret(false), queue(0), queue_prev(0), queue_next(0), all_prev(0), all_next(0), sched_round(0), 
+	  priority(PRIORITY_GAMEPLAY), preempted(false), shared(false), call_base(0), call_depth(0),
+	  stk(16), native_budget(-1), result(CLValue::Null()), inside_run_method(0), 
 	  linenum(-1), filename("<input>"), error_string("<no error>")
 {
+	sp = &stk[0];
+	timer_node.data = this;
+
 	// register thread in context
-	context->registerThread(CLValue(this));
+	context->registerThread(this);
 }
 
 CLThread::~CLThread()
@@ -33,7 +43,7 @@ CLThread::~CLThread()
 	kill();
 
 	// unregister thread in context
-	getContext()->unregisterThread(CLValue(this));
+	getContext()->unregisterThread(this);
 }
 
 void CLThread::runtimeError(std::string err, bool fatal)
@@ -55,18 +65,76 @@ void CLThread::init(CLValue fn, std::vector<CLValue> args, CLValue self)
 	assert(state == UNINITIALIZED);
 
 	// fake function call
+	pushCall(fn, args, self);
+
+	state = RUNNING;
+	getContext()->ready[priority].push(this);
+
+	op_mcall();
 
+	// external function: already done
+	if ((state == RUNNING) && (wait == WAIT_NONE) && callstack.empty())
+	{
+		result = stackPop();
+		state = DONE;
+		finish();
+	}
+}
+
+void CLThread::pushCall(CLValue &fn, std::vector<CLValue> &args, CLValue &self)
+{
 	// push function & self value
+	stackReserve(args.size() + 3);
 	stackPush(fn);
 	stackPush(self.isNull() ? getContext()->getRootTable() : self);
 
 	// push function arguments and argc
 	for (size_t i=0; i<args.size(); ++i) stackPush(args[i]);
 	stackPush(CLValue(static_cast<int>(args.size())));
+}
 
-	state = RUNNING;
+CLValue CLThread::call(CLValue fn, std::vector<CLValue> &args, CLValue self)
+{
+	bool outermost = (call_depth == 0);
+	if (outermost)
+	{
+		assert(!inside_run_method && (queue == 0)); // not a scheduled thread
+		kill();
+		state = RUNNING;
+	} else if (state != RUNNING) {
+		return CLValue::Null(); // killed by a fatal error in an enclosing call
+	}
+
+	size_t stack_base = stackSize(), frame_base = callstack.size();
+	size_t old_call_base = call_base;
+	bool old_inside_run_method = inside_run_method;
 
+	pushCall(fn, args, self);
+
+	++call_depth;
 	op_mcall();
+	if ((state == RUNNING) && (callstack.size() > frame_base))
+	{
+		// run until the called function returns
+		call_base = frame_base;
+		inside_run_method = false;
+		run();
+		inside_run_method = old_inside_run_method;
+		call_base = old_call_base;
+	}
+	--call_depth;
+
+	CLValue value;
+	if (state == RUNNING)
+	{
+		if (callstack.size() == frame_base) value = stackPop();
+		else callstack.resize(frame_base); // aborted by yield
+
+		sp = &stk[0] + stack_base;
+	}
+
+	if (outermost) kill();
+	return value;
 }
 
 void CLThread::run(int timeout)
@@ -79,19 +147,34 @@ void CLThread::run(int timeout)
 	CLFunction *fn = 0;
 	std::vector<CLInstruction> *code = 0;
 
+	std::chrono::steady_clock::time_point run_start = std::chrono::steady_clock::now();
+	preempted = false;
+
 	result.setNull();
 
 redo:
-	if (state != RUNNING) goto done; // reason for this: op_ret, op_mcall might kill/exit thread
+	// reason for this: op_ret, op_mcall might kill/exit/block thread or return from a synchronous call
+	if ((state != RUNNING) || (wait != WAIT_NONE) || (callstack.size() == call_base)) goto done;
 
 	ci   = &callstackTop();
 	fn   = GET_FUNCTION(ci->func);
 	code = &fn->code;
 
+	// native or hot function? run its native code until it calls, returns or suspends
+	if (fn->native_code || fn->jit_code)
+	{
+		native_budget = timeout;
+		int exit_code = fn->native_code ? fn->native_code(this) : CLJit::execute(this, fn, ci->ip);
+		timeout = native_budget;
+
+		if (exit_code == CLJit::SUSPEND) goto done;
+		goto redo;
+	}
+
 	for (;;)
 	{
 		// timeout?
-		if ((timeout != -1) && (0 == timeout--)) goto done;
+		if ((timeout != -1) && (0 == timeout--)) { preempted = true; goto done; }
 
 		// fetch instruction
 		CLInstruction *inst = &(*code)[ci->ip];
@@ -173,94 +256,11 @@ redo:
 			case OP_NEWARRAY: stackPush(CLValue(new CLArray(getContext()))); break; // create new array on stack
 
 			// Get/Set/Iterator operations
-			case OP_TABSET: 
-			{ 
-				CLValue v = stackPop(); CLValue k = stackPop(); CLValue t = stackPop();
-				if (t.type & CL_RAW_ISOBJECT) {
-					t.set(k, v);
-				} else {
-					runtimeError(std::string("Can't set slot '") + k.toString() + "' of non-object '" + t.toString() + "'", true);
-					goto done; // thread is killed, so bail out here..
-				}
-				stackPush(v);
-				break;
-			}
-
-			case OP_TABGET: 
-			{
-				CLValue k = stackPop();
-				CLValue t = stackPop();
-				if (t.isObject()) {
-					CLValue result;
-					if (!t.getObjectUnsave<CLObject>()->get(k, result))
-					{
-						runtimeError(std::string("Slot ") + k.toString() + " does not exist.", true);
-						goto done; // thread is killed, so bail out here..
-					}
-					stackPush(result);
-				} else {
-					runtimeError(std::string("Can't get slot '") + k.toString() + "' of non-object '" + t.toString() + "'", true);
-					goto done; // thread is killed, so bail out here..
-					//stackPush(CLValue::Null()); // null result
-				}
-				break;
-			}
-
-			case OP_TABGET2: 
-			{
-				CLValue k = stackPop();
-				CLValue t = stackPop();
-
-				if (t.isObject()) {
-					CLValue result;
-					if (!t.getObjectUnsave<CLObject>()->get(k, result))
-					{
-						runtimeError(std::string("Slot ") + k.toString() + " does not exist.", true);
-						goto done; // thread is killed, so bail out here..
-					}
-					stackPush(result);
-				} else {
-					runtimeError(std::string("Can't get slot '") + k.toString() + "' of non-object '" + t.toString() + "'", true);
-					goto done; // thread is killed, so bail out here..
-					//stackPush(CLValue::Null()); // null result
-				}
-
-				stackPush(t);
-				break;
-			}
-
-			case OP_TABIT:
-			{
-				CLValue t = stackPop();
-				stackPush(t);
-				if (t.isObject()) {
-					stackPush(t.getObjectUnsave<CLObject>()->begin());
-				} else {
-					runtimeError(std::string("Can't iterate over '") + t.toString() + "'", true);
-					goto done; // thread is killed, so bail out here..
-					//stackPush(CLValue::Null()); // null result
-				}
-				break;
-			}
-
-			case OP_TABNEXT:
-			{
-				CLValue it = stackPop();
-				CLValue t = stackPop();
-				CLValue key, val;
-				if (t.isObject()) {
-					it = GET_OBJECT(t)->next(it, key, val);
-				} else {
-					runtimeError(std::string("Can't iterate over '") + t.toString() + "'", true);
-					goto done; // thread is killed, so bail out here..
-					//it = CLValue::Null(); // null result
-				}
-				stackPush(t);
-				stackPush(it);	
-				stackPush(val);
-				stackPush(key);
-				break;
-			}
+			case OP_TABSET:  if (!op_tabset()) goto done; break;       // thread is killed, so bail out here..
+			case OP_TABGET:  if (!op_tabget(false)) goto done; break;
+			case OP_TABGET2: if (!op_tabget(true)) goto done; break;
+			case OP_TABIT:   if (!op_tabit()) goto done; break;
+			case OP_TABNEXT: if (!op_tabnext()) goto done; break;
 
 			// Clone operator
 			case OP_CLONE: stackPush(stackPop().clone()); break;
@@ -271,11 +271,18 @@ redo:
 			case OP_JMPF: if (!stackPop().toBool()) ci->ip = inst->arg; break;
 			case OP_JMP0: if ( stackPop().isNull()) ci->ip = inst->arg; break;
 
+			// Loops
+			case OP_RANGEPREP: if (op_rangeprep()) ci->ip = inst->arg; break;
+			case OP_RANGELOOP: if (op_rangeloop()) ci->ip = inst->arg; break;
+			case OP_TABLOOP:   if (op_tabloop())   ci->ip = inst->arg; break;
+
 			// Function call/return/yield
 			case OP_MCALL: op_mcall(); goto redo;
+			case OP_TAILCALL: op_mcall(true); goto redo;
 			case OP_RET: op_ret(); goto redo; 
 			case OP_YIELD: 
 				result = stackPop(); 
+				if (call_depth > 0) { yieldInCall(); goto done; }
 				if (do_yield) goto done;
 				result.setNull();
 				break;
@@ -292,18 +299,324 @@ redo:
 	}
 
 done:
+	// accounting
+	unsigned long run_time = (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - run_start).count();
+	++stats.resumes;
+	if (preempted) ++stats.preemptions;
+	stats.run_time += run_time;
+	stats.max_run_time = std::max(stats.max_run_time, run_time);
+
 	inside_run_method = false;
 }
 
+bool CLThread::op_tabset()
+{
+	CLValue v = stackPop(); CLValue k = stackPop(); CLValue t = stackPop();
+	if (t.type & CL_RAW_ISOBJECT) {
+		t.set(k, v);
+	} else {
+		runtimeError(std::string("Can't set slot '") + k.toString() + "' of non-object '" + t.toString() + "'", true);
+		return false;
+	}
+	stackPush(v);
+	return true;
+}
+
+bool CLThread::op_tabget(bool push_table)
+{
+	CLValue k = stackPop();
+	CLValue t = stackPop();
+	if (t.isObject()) {
+		CLValue result;
+		if (!t.getObjectUnsave<CLObject>()->get(k, result))
+		{
+			runtimeError(std::string("Slot ") + k.toString() + " does not exist.", true);
+			return false;
+		}
+		stackPush(result);
+	} else {
+		runtimeError(std::string("Can't get slot '") + k.toString() + "' of non-object '" + t.toString() + "'", true);
+		return false;
+		//stackPush(CLValue::Null()); // null result
+	}
+
+	if (push_table) stackPush(t);
+	return true;
+}
+
+bool CLThread::op_tabit()
+{
+	CLValue t = stackPop();
+	stackPush(t);
+	if (t.isObject()) {
+		stackPush(t.getObjectUnsave<CLObject>()->begin());
+	} else {
+		runtimeError(std::string("Can't iterate over '") + t.toString() + "'", true);
+		return false;
+		//stackPush(CLValue::Null()); // null result
+	}
+	return true;
+}
+
+bool CLThread::op_tabnext()
+{
+	CLValue it = stackPop();
+	CLValue t = stackPop();
+	CLValue key, val;
+	if (t.isObject()) {
+		it = GET_OBJECT(t)->next(it, key, val);
+	} else {
+		runtimeError(std::string("Can't iterate over '") + t.toString() + "'", true);
+		return false;
+		//it = CLValue::Null(); // null result
+	}
+	stackPush(t);
+	stackPush(it);	
+	stackPush(val);
+	stackPush(key);
+	return true;
+}
+
+// counter < limit? (both numeric)
+static inline bool rangeLess(CLValue &counter, CLValue &limit)
+{
+	if ((counter.type == CL_INTEGER) && (limit.type == CL_INTEGER)) return counter.value.integer < limit.value.integer;
+	return counter.toFloat() < limit.toFloat();
+}
+
+bool CLThread::op_rangeprep()
+{
+	CLValue &counter = *(sp-2), &limit = *(sp-1);
+	if (!counter.isNumeric() || !limit.isNumeric())
+	{
+		runtimeError(std::string("Range bounds must be numbers, not '") + counter.toString() + "' and '" + limit.toString() + "'", false);
+		return true; // skip loop
+	}
+	return !rangeLess(counter, limit);
+}
+
+bool CLThread::op_rangeloop()
+{
+	CLValue &counter = *(sp-2), &limit = *(sp-1);
+	if (counter.type == CL_INTEGER) ++counter.value.integer; else counter.value.real += 1.0f;
+	return rangeLess(counter, limit);
+}
+
+bool CLThread::op_tabloop()
+{
+	CLValue &t = *(sp-2), &it = *(sp-1);
+	if (it.isNull()) return false;
+
+	if ((t.type == CL_ARRAY) && (it.type == CL_INTEGER)) // arrays: no virtual calls
+	{
+		CLArray *a = GET_ARRAY(t);
+		int i = it.value.integer;
+		if ((i < 0) || (size_t(i) >= a->size())) return false; // array has shrunk
+
+		it = (size_t(i+1) < a->size()) ? CLValue(i+1) : CLValue::Null();
+		stackPush(a->at(i));
+		stackPush(CLValue(i));
+		return true;
+	}
+
+	if (!t.isObject()) return false;
+	CLValue key, val;
+	it = GET_OBJECT(t)->next(it, key, val);
+	stackPush(val);
+	stackPush(key);
+	return true;
+}
+
 void CLThread::kill()
 {
+	unblock();
 	result.setNull();
 	callstack.clear(); // empty callstack
-	stk.clear(); // empty stack
+	sp = &stk[0]; // empty stack
 	state = DONE;
+	finish();
+}
+
+void CLThread::finish()
+{
+	// leave ready queue
+	if (queue) queue->remove(this);
+
+	// joining threads get the result
+	while (!joiners.empty()) joiners.front()->wake(result);
 }
 
-void CLThread::op_mcall()
+void CLThread::yieldInCall()
+{
+	// CLThread::call unwinds the called function
+	result.setNull();
+	runtimeError("Can't yield inside a synchronous call, returning null", false);
+}
+
+void CLThread::reset()
+{
+	assert(!isRunning() && !inside_run_method && (queue == 0));
+
+	// stk and callstack keep their capacity
+	kill();
+	state = UNINITIALIZED;
+	do_yield = true;
+	priority = PRIORITY_GAMEPLAY;
+	stats = Stats();
+	linenum = -1;
+	filename = "<input>";
+	error_string = "<no error>";
+}
+
+// Scheduling ////////////////////////////////////////////////
+
+bool CLThread::block(WaitReason reason, bool from_call)
+{
+	if ((state != RUNNING) || (wait != WAIT_NONE)) return false;
+	if (!do_yield || (call_depth > 0))
+	{
+		runtimeError("Can't wait in a thread that doesn't yield or inside a synchronous call", false);
+		return false;
+	}
+
+	if (queue) queue->remove(this); // leave ready queue
+	wait = reason;
+	wait_result = from_call;
+	wait_ret = false;
+	return true;
+}
+
+void CLThread::unblock()
+{
+	CLContext *context = getContext();
+
+	switch (wait)
+	{
+		case WAIT_NONE:
+			return;
+
+		case WAIT_JOIN:
+			GET_THREAD(wait_target)->joiners.remove(this);
+			wait_target.setNull();
+			break;
+
+		case WAIT_SIGNAL:
+		{
+			std::map<std::string, CLThreadQueue>::iterator it = context->signal_queues.find(wait_signal);
+			assert(it != context->signal_queues.end());
+			it->second.remove(this);
+			if (it->second.empty()) context->signal_queues.erase(it);
+			wait_signal.clear();
+			break;
+		}
+
+		case WAIT_TIMER:
+			context->timers.cancel(&timer_node);
+			break;
+
+		case WAIT_SUSPEND:
+			break;
+
+		case WAIT_FUTURE:
+			GET_FUTURE(wait_target)->waiters.remove(this);
+			wait_target.setNull();
+			break;
+	}
+	wait = WAIT_NONE;
+}
+
+void CLThread::wake(CLValue value)
+{
+	if (wait == WAIT_NONE) return;
+	unblock();
+
+	// blocked in an external call: the wake value is its result
+	if (wait_result) *(sp-1) = value;
+	wait_result = false;
+
+	getContext()->ready[priority].push(this);
+
+	// blocked in a tail call: return that result now
+	if (wait_ret)
+	{
+		wait_ret = false;
+		op_ret();
+	}
+}
+
+bool CLThread::join(CLThread *target)
+{
+	if ((target == this) || !target->isRunning()) return false;
+	if (!block(WAIT_JOIN, inside_run_method)) return false;
+
+	wait_target = CLValue(target);
+	target->joiners.push(this);
+	return true;
+}
+
+bool CLThread::waitSignal(const std::string &name)
+{
+	if (!block(WAIT_SIGNAL, inside_run_method)) return false;
+
+	wait_signal = name;
+	getContext()->signal_queues[name].push(this);
+	return true;
+}
+
+bool CLThread::sleep(unsigned long ms)
+{
+	if (!block(WAIT_TIMER, inside_run_method)) return false;
+
+	CLContext *context = getContext();
+	context->timers.schedule(&timer_node, context->timers.getTime() + ms);
+	return true;
+}
+
+bool CLThread::await(CLFuture *future)
+{
+	if (future->isDone()) return false;
+	if (!block(WAIT_FUTURE, inside_run_method)) return false;
+
+	wait_target = CLValue(future);
+	future->waiters.push(this);
+	return true;
+}
+
+bool CLThread::suspend()
+{
+	return block(WAIT_SUSPEND, inside_run_method);
+}
+
+void CLThread::setPriority(Priority p)
+{
+	if (p == priority) return;
+
+	// move to the ready queue of the new class
+	CLContext *context = getContext();
+	bool is_ready = (queue == &context->ready[priority]);
+	if (is_ready) queue->remove(this);
+	priority = p;
+	if (is_ready) context->ready[priority].push(this);
+}
+
+bool CLThread::resume()
+{
+	if (wait != WAIT_SUSPEND) return false;
+	wake(CLValue::True());
+	return true;
+}
+
+void CLThread::stackReserve(size_t n)
+{
+	size_t used = stackSize();
+	if (used + n > stk.size())
+	{
+		stk.resize(std::max(used + n, stk.size() * 2));
+		sp = &stk[0] + used;
+	}
+}
+
+void CLThread::op_mcall(bool tailcall)
 {
 	CLValue func, argc, self;	
 	std::vector<CLValue> args;
@@ -320,10 +633,27 @@ void CLThread::op_mcall()
 	switch (func.type)
 	{
 		case CL_FUNCTION:
+		{
+			CLFunction *fn = GET_FUNCTION(func);
+
+			// tier up to native code after a number of calls
+			if (!fn->jit_code && !fn->native_code && (++fn->call_count == CLJit::getThreshold())) CLJit::compile(fn);
+
 			// throw away arguments or create default null ones
-			args.resize(GET_FUNCTION(func)->num_args, CLValue::Null()); 
-			callstackPush(func, self, args);
+			args.resize(fn->num_args, CLValue::Null()); 
+			if (tailcall)
+			{
+				CallInfo &ci = callstackTop();
+				ci.ip = 0;
+				ci.func = func;
+				ci.self = self;
+				ci.locals.swap(args);
+			} else {
+				callstackPush(func, self, args);
+			}
+			stackReserve(fn->max_stack);
 			break;
+		}
 
 		case CL_EXTERNALFUNCTION:
 		{
@@ -331,6 +661,13 @@ void CLThread::op_mcall()
 			if (fn) {
 				CLValue result = fn(*this, args, self);
 				stackPush(result);
+
+				// tail call: return the result (after wake-up, if the function has blocked the thread)
+				if (tailcall && (state == RUNNING))
+				{
+					callstackTop().locals.clear(); // the return skips the function's locals cleanup
+					if (wait != WAIT_NONE) wait_ret = true; else op_ret();
+				}
 			} else {
 				runtimeError(std::string("Could not resolve external function '") + func.toString() + "', ignoring call", true);
 				return; // thread is killed, so bail out here..
@@ -357,17 +694,18 @@ void CLThread::op_ret()
 #endif
 	callstackPop();
 
-	if (callstack.empty()) // thread has finished?
+	if (callstack.empty() && (call_depth == 0)) // thread has finished?
 	{
 		// fetch result from stack
 		result = stackPop();
 #ifdef DEBUG
-		if (!stk.empty())
+		if (stackSize() != 0)
 		{
-			cout << "Internal error: Stack not empty after function return:" << stk.size() << " items left" << endl;
+			cout << "Internal error: Stack not empty after function return:" << stackSize() << " items left" << endl;
 		}
 #endif
 		state = DONE;
+		finish();
 	} 
 }
 
@@ -380,7 +718,8 @@ void CLThread::save(CLSerialSaver &S, CLThread *thread)
 
 	S.IO(tmp = thread->state); 			// ThreadState state
 	CLValue::save(S, thread->result); 		// CLValue result
-	CLValue::saveVector(S, thread->stk);		// std::vector<CLValue> stk;
+	std::vector<CLValue> live(&thread->stk[0], thread->sp);
+	CLValue::saveVector(S, live);			// std::vector<CLValue> stk (used part)
 
 	S.IO(tmp = thread->callstack.size());		// callstack.size()
 	for (size_t i=0; i<thread->callstack.size(); ++i)	// struct CallInfo 
@@ -394,6 +733,20 @@ void CLThread::save(CLSerialSaver &S, CLThread *thread)
 	S.IO(tmp = thread->linenum);
 	S.IO(thread->filename);
 	S.IO(thread->error_string);
+
+	// scheduling state (timers are saved relative to the context clock)
+	S.IO(tmp = thread->priority);
+	S.IO(tmp = thread->wait);
+	S.IO(tmp = thread->wait_result);
+	S.IO(tmp = thread->wait_ret);
+	switch (thread->wait)
+	{
+		case WAIT_JOIN:   CLValue::save(S, thread->wait_target); break;
+		case WAIT_FUTURE: CLValue::save(S, thread->wait_target); break;
+		case WAIT_SIGNAL: S.IO(thread->wait_signal); break;
+		case WAIT_TIMER:  S.IO(tmp = thread->timer_node.expiry - std::min(thread->timer_node.expiry, thread->getContext()->getClock())); break;
+		default: break;
+	}
 }
 
 CLThread *CLThread::load(CLSerialLoader &S)
@@ -404,7 +757,8 @@ CLThread *CLThread::load(CLSerialLoader &S)
 
 	S.IO(tmp); thread->state = ThreadState(tmp);	// ThreadState state
 	thread->result = CLValue::load(S);		// CLValue result
-	thread->stk = CLValue::loadVector(S);		// std::vector<CLValue> stk
+	thread->stk = CLValue::loadVector(S);		// std::vector<CLValue> stk (used part)
+	size_t used = thread->stk.size();
 	
 	S.IO(tmp); thread->callstack.resize(tmp);	// callstack.size()
 	for (size_t i=0; i<thread->callstack.size(); ++i)	// struct CallInfo 
@@ -415,10 +769,95 @@ CLThread *CLThread::load(CLSerialLoader &S)
 		thread->callstack[i].locals = CLValue::loadVector(S);
 	}
 
+	// reserve stack for all frames (where each one started is unknown)
+	size_t reserve = 1;
+	for (size_t i=0; i<thread->callstack.size(); ++i)
+	{
+		CLValue &func = thread->callstack[i].func;
+		if (func.type != CL_FUNCTION) throw std::runtime_error("Invalid thread: callstack entry is not a function");
+		CLFunction *fn = GET_FUNCTION(func);
+		if (thread->callstack[i].ip >= fn->code.size()) throw std::runtime_error("Invalid thread: instruction pointer out of range");
+		reserve += fn->max_stack;
+	}
+	thread->stk.resize(used + reserve);
+	thread->sp = &thread->stk[0] + used;
+
 	S.IO(thread->linenum);
 	S.IO(thread->filename);
 	S.IO(thread->error_string);
 
+	// scheduling state
+	S.IO(tmp); if (tmp >= NUM_PRIORITIES) throw std::runtime_error("Invalid thread: unknown priority");
+	thread->priority = Priority(tmp);
+	WaitReason wait;
+	S.IO(tmp); wait = WaitReason(tmp);
+	bool wake = false;        // the wait is over already
+	CLValue wake_value;
+	S.IO(tmp); bool wait_result = (tmp != 0);
+	S.IO(tmp); bool wait_ret = (tmp != 0);
+
+	if (thread->state == RUNNING)
+	{
+		thread->getContext()->ready[thread->priority].push(thread);
+
+		bool restored = true;
+		switch (wait)
+		{
+			case WAIT_NONE:
+				break;
+
+			case WAIT_JOIN:
+			{
+				CLValue target = CLValue::load(S);
+				if (target.type != CL_THREAD) throw std::runtime_error("Invalid thread: join target is not a thread");
+				restored = thread->join(GET_THREAD(target));
+				break;
+			}
+
+			case WAIT_SIGNAL:
+			{
+				std::string name; S.IO(name);
+				restored = thread->waitSignal(name);
+				break;
+			}
+
+			case WAIT_TIMER:
+				S.IO(tmp);
+				restored = thread->sleep(tmp);
+				break;
+
+			case WAIT_SUSPEND:
+				restored = thread->suspend();
+				break;
+
+			case WAIT_FUTURE:
+			{
+				CLValue target = CLValue::load(S);
+				if (target.type != CL_FUTURE) throw std::runtime_error("Invalid thread: awaited value is not a future");
+				CLFuture *future = GET_FUTURE(target);
+				if (future->isDone()) // (its job was interrupted, see CLFuture::load)
+				{
+					restored = thread->suspend();
+					wake = true;
+					wake_value = future->getResult();
+				} else {
+					restored = thread->await(future);
+				}
+				break;
+			}
+
+			default:
+				throw std::runtime_error("Invalid thread: unknown wait reason");
+		}
+		if (!restored) throw std::runtime_error("Invalid thread: can't restore wait");
+
+		thread->wait_result = wait_result;
+		thread->wait_ret = wait_ret;
+		if (wake) thread->wake(wake_value);
+	} else if (wait != WAIT_NONE) {
+		throw std::runtime_error("Invalid thread: finished thread is blocked");
+	}
+
 	return thread;
 }
 
@@ -440,6 +879,16 @@ bool CLThread::get(CLValue &key, CLValue &val)
 		val = CLValue(new CLExternalFunction(getContext(), "sys_thread_suspend")); return true;
 	} else if (s == "resume") {
 		val = CLValue(new CLExternalFunction(getContext(), "sys_thread_resume")); return true;
+	} else if (s == "join") {
+		val = CLValue(new CLExternalFunction(getContext(), "sys_thread_join")); return true;
+	} else if (s == "isblocked") {
+		val = CLValue(new CLExternalFunction(getContext(), "sys_thread_isblocked")); return true;
+	} else if (s == "setpriority") {
+		val = CLValue(new CLExternalFunction(getContext(), "sys_thread_setpriority")); return true;
+	} else if (s == "getpriority") {
+		val = CLValue(new CLExternalFunction(getContext(), "sys_thread_getpriority")); return true;
+	} else if (s == "stats") {
+		val = CLValue(new CLExternalFunction(getContext(), "sys_thread_stats")); return true;
 	} else if (s == "result") {
 		val = this->result; return true;
 	}
@@ -463,8 +912,9 @@ CLValue CLThread::next(CLValue iterator, CLValue &key, CLValue &value)
 // from CLCollectable ////////////////////////////////////////
 void CLThread::markReferenced()
 {
-	// mark result value
+	// mark result value and the thread or future waited for
 	result.markObject();
+	wait_target.markObject();
 
 	// mark references in callstack
 	size_t cs_size = callstack.size();
@@ -477,12 +927,18 @@ void CLThread::markReferenced()
 	}
 
 	// mark stack
-	for (size_t i=0; i<stk.size(); ++i)
+	for (CLValue *v = &stk[0]; v != sp; ++v)
 	{
-		stk[i].markObject();
+		v->markObject();
 	}
 }
 
+bool CLThread::isDirty()
+{
+	// a thread's state changes with every instruction it runs, pooled ones aren't saved
+	return queue != &getContext()->thread_pool;
+}
+
 //////////////////////////////////////////////////////////////
 
 CLValue CLThread::clone()
@@ -23,13 +23,40 @@
 
 #include "../value/clobject.h"
 #include "../value/clvalue.h"
+#include "cltimerwheel.h"
 
 #include <vector>
 #include <string>
+#include <map>
 #include <assert.h>
 
 #include <iostream>
 
+class CLThread;
+
+// Intrusive FIFO of threads (ready queue, wait queues). A thread is a member of at most one
+// queue at a time, so insertion and removal are O(1) and allocate nothing.
+class CLThreadQueue
+{
+public:
+	CLThreadQueue() : head(0), tail(0), count(0) {}
+
+	bool empty() const        { return head == 0; }
+	size_t size() const       { return count; }
+	CLThread *front() const   { return head; }
+
+	inline void push(CLThread *t);
+	inline void remove(CLThread *t);
+	inline CLThread *pop();
+
+private:
+	CLThreadQueue(const CLThreadQueue &);            // not copyable: threads point to their queue
+	CLThreadQueue &operator=(const CLThreadQueue &);
+
+	CLThread *head, *tail;
+	size_t count;
+};
+
 class CLThread : public CLObject
 {
 public:
@@ -42,10 +69,54 @@ public:
 	void run(int timeout = -1);
 	void kill();
 
+	// Run fn to completion and return its result (see CLContext::call). Calls may be nested
+	// from external functions. Yielding inside a call is a runtime error that returns null.
+	CLValue call(CLValue fn, std::vector<CLValue> &args, CLValue self);
+
 	bool isUninitialized() { return state == UNINITIALIZED; }
 	bool isRunning() { return state == RUNNING; }
 	bool fatalErrorOccured() { return state == FATAL_ERROR; }
 
+	// Blocking waits. A blocked thread is still running, but the scheduler does not resume it
+	// until it is woken. The waits are meant to be called from an external function on the
+	// thread that blocks; the woken thread sees the wake value as that function's result.
+	bool isBlocked() { return wait != WAIT_NONE; }
+	bool join(CLThread *target);               // wait until target has finished (false: already done)
+	bool waitSignal(const std::string &name);  // wait for CLContext::signal(name)
+	bool sleep(unsigned long ms);              // wait for ms milliseconds of context clock
+	bool await(class CLFuture *future);        // wait until future is done (false: already done)
+	bool suspend();                            // wait for resume() (may also be called on other threads)
+	bool resume();
+	void wake(CLValue value = CLValue::Null());
+
+	// Priority classes. CLContext::schedule runs ready threads of a class before those of
+	// the next one, so input handlers don't wait for gameplay or background scripts.
+	enum Priority
+	{
+		PRIORITY_INPUT=0,      // input and UI handlers
+		PRIORITY_GAMEPLAY=1,   // default
+		PRIORITY_BACKGROUND=2, // ambience etc., runs on what is left of the frame budget
+		NUM_PRIORITIES=3
+	};
+	Priority getPriority() { return priority; }
+	void setPriority(Priority p);
+
+	// Accounting (not saved)
+	struct Stats
+	{
+		Stats() : resumes(0), preemptions(0), run_time(0), max_run_time(0) {}
+
+		unsigned long resumes;      // calls of run()
+		unsigned long preemptions;  // runs that ended because the timeout expired
+		unsigned long long run_time;// microseconds spent in run()
+		unsigned long max_run_time; // longest single run() in microseconds
+	};
+	const Stats &getStats() { return stats; }
+	bool wasPreempted() { return preempted; } // did the last run() end because the timeout expired?
+
+	// A thread that scripts may refer to (see sys.currentthread) is never recycled.
+	void setShared() { shared = true; }
+
 	CLValue getResult() { return result; }
 
 	void runtimeError(std::string err, bool fatal); // display runtime error and kill thread if fatal
@@ -63,12 +134,58 @@ private:
 	};
 	ThreadState state;
 
+	void finish(); // thread is done: leave the scheduler, wake joining threads
+	void reset();  // back to UNINITIALIZED for reuse (see CLContext::recycleThread)
+
+	// Scheduling
+	enum WaitReason
+	{
+		WAIT_NONE=0,    // ready (or not running at all)
+		WAIT_JOIN=1,    // waiting for wait_target to finish
+		WAIT_SIGNAL=2,  // waiting for wait_signal
+		WAIT_TIMER=3,   // waiting for the context clock to reach timer_node.expiry
+		WAIT_SUSPEND=4, // suspended until resume()
+		WAIT_FUTURE=5   // waiting for wait_target (a future) to be done
+	};
+	WaitReason wait;
+	bool wait_result;       // blocked inside an external call: wake value replaces its result
+	bool wait_ret;          // blocked inside a tail call: return after wake
+	CLValue wait_target;    // WAIT_JOIN, WAIT_FUTURE
+	std::string wait_signal;// WAIT_SIGNAL
+	CLTimerWheel::Node timer_node; // WAIT_TIMER
+
+	bool block(WaitReason reason, bool from_call); // leave ready queue (false if the thread can't block)
+	void unblock();                                // leave wait queue
+
+	friend class CLThreadQueue;
+	friend class CLContext;
+	CLThreadQueue *queue;                   // ready or wait queue this thread is in, if any
+	CLThread *queue_prev, *queue_next;
+	CLThread *all_prev, *all_next;          // list of all threads of the context
+	CLThreadQueue joiners;                  // threads waiting for this one to finish
+	unsigned sched_round;                   // last scheduler round this thread ran in
+	Priority priority;
+	bool preempted;
+	Stats stats;
+	bool shared;
+
+	// synchronous calls
+	size_t call_base;   // run() returns when the callstack shrinks to this size
+	int call_depth;     // number of nested calls in progress
+	void pushCall(CLValue &fn, std::vector<CLValue> &args, CLValue &self);
+	void yieldInCall();
+
+	// Operand stack. Room for CLFunction::max_stack values is reserved on each call, so
+	// pushes and pops are unchecked (bytecode is verified by CLVerifier).
 	std::vector<CLValue> stk;
+	CLValue *sp; // first free slot
 
-	inline void stackPush(const CLValue &v) { stk.push_back(v); }
-	inline CLValue stackPop()               { CLValue v = *(stk.end()-1); stk.pop_back(); return v; }
-	inline CLValue &stackGet()              { return *(stk.end()-1); }
-	inline void stackDup(int offset)        { stk.push_back(*(stk.rbegin()+offset)); }
+	inline void stackPush(const CLValue &v) { *sp++ = v; }
+	inline CLValue stackPop()               { return *--sp; }
+	inline CLValue &stackGet()              { return *(sp-1); }
+	inline void stackDup(int offset)        { *sp = *(sp-1-offset); ++sp; }
+	inline size_t stackSize()               { return sp - &stk[0]; }
+	void stackReserve(size_t n);            // make room for n more values
 
 	struct CallInfo
 	{
@@ -92,9 +209,22 @@ private:
 	inline void callstackPop()                            { callstack.pop_back(); }
 	inline CallInfo &callstackTop()                       { return *(callstack.end()-1); }
 
-	void op_mcall();
+	void op_mcall(bool tailcall = false); // (tailcall: replace current frame)
 	void op_ret();
 
+	bool op_tabset();                // return false if the thread was killed
+	bool op_tabget(bool push_table); // (push_table: OP_TABGET2)
+	bool op_tabit();
+	bool op_tabnext();
+
+	// loop instructions (return true if the jump is taken)
+	bool op_rangeprep();
+	bool op_rangeloop();
+	bool op_tabloop();
+
+	friend struct CLNativeOps; // native code helpers (see clnativeops.h)
+	int native_budget;      // remaining timeout while executing native code
+
 	CLValue result; // yield result or null if RUNNING, return result if DONE
 
 	bool inside_run_method; // prevents the run() method from being called recursively
@@ -119,6 +249,7 @@ private:
 
         // from CLCollectable ////////////////////////////////////////
 	void markReferenced();
+	bool isDirty();
 
 	// debug info ////////////////////////////////////////////////
 	int linenum;
@@ -133,5 +264,35 @@ public:
 	static CLThread *load(class CLSerialLoader &S);
 };
 
+// CLThreadQueue ///////////////////////////////////////////////
+
+inline void CLThreadQueue::push(CLThread *t)
+{
+	assert(t->queue == 0);
+	t->queue = this;
+	t->queue_prev = tail;
+	t->queue_next = 0;
+	if (tail) tail->queue_next = t; else head = t;
+	tail = t;
+	++count;
+}
+
+inline void CLThreadQueue::remove(CLThread *t)
+{
+	assert(t->queue == this);
+	if (t->queue_prev) t->queue_prev->queue_next = t->queue_next; else head = t->queue_next;
+	if (t->queue_next) t->queue_next->queue_prev = t->queue_prev; else tail = t->queue_prev;
+	t->queue = 0;
+	t->queue_prev = t->queue_next = 0;
+	--count;
+}
+
+inline CLThread *CLThreadQueue::pop()
+{
+	CLThread *t = head;
+	if (t) remove(t);
+	return t;
+}
+
 #endif
 
@@ -0,0 +1,120 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "cltimerwheel.h"
+
+#include <assert.h>
+
+CLTimerWheel::CLTimerWheel()
+	: now(0), overflow(0)
+{
+	for (int l=0; l<LEVELS; ++l)
+		for (int s=0; s<SLOTS; ++s) slots[l][s] = 0;
+}
+
+void CLTimerWheel::link(Node **head, Node *node)
+{
+	node->head = head;
+	node->prev = 0;
+	node->next = *head;
+	if (*head) (*head)->prev = node;
+	*head = node;
+}
+
+void CLTimerWheel::unlink(Node *node)
+{
+	if (node->prev) node->prev->next = node->next; else *node->head = node->next;
+	if (node->next) node->next->prev = node->prev;
+	node->prev = node->next = 0;
+	node->head = 0;
+}
+
+void CLTimerWheel::schedule(Node *node, unsigned long expiry)
+{
+	if (node->isScheduled()) unlink(node);
+	if (expiry <= now) expiry = now + 1;
+	node->expiry = expiry;
+	place(node);
+}
+
+void CLTimerWheel::place(Node *node)
+{
+	// level l holds timers due within 64^(l+1) ms, in the slot of their l-th 6 bit digit
+	// (cascaded timers may be due now: the slot of level 0 advance() expires next)
+	unsigned long expiry = node->expiry, delta = expiry - now;
+	for (int l=0; l<LEVELS; ++l)
+	{
+		if (delta < (1UL << (SLOT_BITS * (l+1))))
+		{
+			link(&slots[l][(expiry >> (SLOT_BITS * l)) & (SLOTS-1)], node);
+			return;
+		}
+	}
+	link(&overflow, node);
+}
+
+void CLTimerWheel::cancel(Node *node)
+{
+	if (node->isScheduled()) unlink(node);
+}
+
+void CLTimerWheel::cascade(Node **head)
+{
+	Node *node = *head;
+	*head = 0;
+	while (node)
+	{
+		Node *next = node->next;
+		node->head = 0;
+		place(node); // (not schedule, it would delay timers due now)
+		node = next;
+	}
+}
+
+CLTimerWheel::Node *CLTimerWheel::advance(unsigned long ms)
+{
+	Node *expired = 0, *expired_tail = 0;
+
+	for (; ms > 0; --ms)
+	{
+		++now;
+
+		// a lower level has wrapped around: move the timers of the next slot one level down
+		for (int l=1; l<=LEVELS; ++l)
+		{
+			if (now & ((1UL << (SLOT_BITS * l)) - 1)) break;
+			if (l == LEVELS) cascade(&overflow);
+			else cascade(&slots[l][(now >> (SLOT_BITS * l)) & (SLOTS-1)]);
+		}
+
+		// everything in the current slot of level 0 expires now
+		Node **head = &slots[0][now & (SLOTS-1)];
+		while (*head)
+		{
+			Node *node = *head;
+			assert(node->expiry == now);
+			unlink(node);
+			if (expired_tail) expired_tail->next = node; else expired = node;
+			expired_tail = node;
+		}
+	}
+
+	return expired;
+}
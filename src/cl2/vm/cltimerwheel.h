@@ -0,0 +1,66 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef CLTIMERWHEEL_H
+#define CLTIMERWHEEL_H
+
+// Hashed hierarchical timer wheel with 1 ms resolution: 4 levels of 64 slots cover about
+// 4.6 hours, later timers wait in an overflow list. Timers are intrusive nodes, so
+// scheduling and cancelling are O(1). Advancing the clock costs O(elapsed ms + expired
+// timers), timers on higher levels are moved down only when their slot comes up.
+class CLTimerWheel
+{
+public:
+	struct Node
+	{
+		Node() : prev(0), next(0), head(0), expiry(0), data(0) {}
+
+		bool isScheduled() const { return head != 0; }
+
+		Node *prev, *next;
+		Node **head;          // list this node is linked into
+		unsigned long expiry; // absolute time
+		void *data;           // owner
+	};
+
+	CLTimerWheel();
+
+	unsigned long getTime() const { return now; }
+
+	void schedule(Node *node, unsigned long expiry); // expiry <= getTime(): expire at the next advance()
+	void cancel(Node *node);                         // no-op if not scheduled
+
+	// Advance the clock by ms, return the expired nodes (unlinked, chained by 'next', earliest first).
+	Node *advance(unsigned long ms);
+
+private:
+	enum { LEVELS = 4, SLOT_BITS = 6, SLOTS = 1 << SLOT_BITS };
+
+	unsigned long now;
+	Node *slots[LEVELS][SLOTS];
+	Node *overflow;
+
+	static void link(Node **head, Node *node);
+	static void unlink(Node *node);
+	void place(Node *node);    // link into the list of its expiry
+	void cascade(Node **head); // place all nodes of a list again
+};
+
+#endif
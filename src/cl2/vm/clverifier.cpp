@@ -0,0 +1,211 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "clverifier.h"
+
+#include "../value/clfunction.h"
+
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+static void fail(size_t ip, const std::string &err)
+{
+	std::stringstream ss; ss << "Invalid bytecode at instruction " << ip << ": " << err;
+	throw std::runtime_error(ss.str());
+}
+
+void CLVerifier::verify(CLFunction *fn)
+{
+	std::vector<CLInstruction> &code = fn->code;
+	size_t n = code.size();
+	if (n == 0) fail(0, "empty function");
+	if (fn->num_args < 0) fail(0, "negative number of arguments");
+
+	// check opcodes & arguments, find jump targets
+	std::vector<bool> is_target(n, false);
+	for (size_t i=0; i<n; ++i)
+	{
+		CLInstruction &inst = code[i];
+		if ((inst.op < OP_NOP) || (inst.op >= NUM_OPCODES)) fail(i, "unknown opcode");
+
+		if (isJumpOpcode(inst.op))
+		{
+			if ((inst.arg < 0) || (size_t(inst.arg) >= n)) fail(i, "jump target out of range");
+			is_target[inst.arg] = true;
+		}
+
+		switch (inst.op)
+		{
+			case OP_PUSHCONST:
+				if ((inst.arg < 0) || (size_t(inst.arg) >= fn->constants.size())) fail(i, "constant out of range");
+				break;
+
+			case OP_POP:
+			case OP_DUP:
+			case OP_PUSHL:
+			case OP_POPL:
+			case OP_ADDL:
+			case OP_DELL:
+				if (inst.arg < 0) fail(i, "negative argument");
+				break;
+
+			case OP_MCALL:
+			case OP_TAILCALL:
+				// argc must be a constant (the stack effect depends on it)
+				if ((i == 0) || (code[i-1].op != OP_PUSHI) || (code[i-1].arg < 0)) fail(i, "call without argument count");
+				break;
+
+			default: break;
+		}
+	}
+	for (size_t i=0; i<n; ++i)
+	{
+		if (is_target[i] && ((code[i].op == OP_MCALL) || (code[i].op == OP_TAILCALL))) fail(i, "jump to call");
+	}
+
+	// follow all paths, tracking stack depth & number of locals
+	std::vector<int> depth(n, -1), locals(n, -1);
+	std::vector<size_t> todo;
+	depth[0] = 0; locals[0] = fn->num_args; todo.push_back(0);
+	int max_depth = 0;
+
+	while (!todo.empty())
+	{
+		size_t i = todo.back(); todo.pop_back();
+		CLInstruction &inst = code[i];
+		int d = depth[i], l = locals[i];
+
+		int pop = 0, push = 0;
+		int push_taken = 0; // additional values pushed if a jump is taken
+		bool fallthrough = true;
+		switch (inst.op)
+		{
+			case OP_NOP:
+			case OP_FILE:
+			case OP_LINE:
+				break;
+
+			case OP_PUSH0:
+			case OP_PUSHSELF:
+			case OP_PUSHROOT:
+			case OP_PUSHCONST:
+			case OP_PUSHEXTFUNC:
+			case OP_PUSHI:
+			case OP_PUSHF:
+			case OP_PUSHS:
+			case OP_PUSHB:
+			case OP_NEWTABLE:
+			case OP_NEWARRAY:
+				push = 1; break;
+
+			case OP_POP: pop = inst.arg; break;
+			case OP_DUP:
+				if (inst.arg >= d) fail(i, "dup below stack bottom");
+				push = 1; break;
+
+			case OP_TABGET:  pop = 2; push = 1; break;
+			case OP_TABGET2: pop = 2; push = 2; break;
+			case OP_TABSET:  pop = 3; push = 1; break;
+			case OP_TABIT:   pop = 1; push = 2; break;
+			case OP_TABNEXT: pop = 2; push = 4; break;
+			case OP_CLONE:   pop = 1; push = 1; break;
+
+			case OP_PUSHL:
+				if (inst.arg >= l) fail(i, "local variable out of range");
+				push = 1; break;
+			case OP_POPL:
+				if (inst.arg >= l) fail(i, "local variable out of range");
+				pop = 1; break;
+			case OP_ADDL: l += inst.arg; break;
+			case OP_DELL:
+				if (inst.arg > l) fail(i, "deleting too many local variables");
+				l -= inst.arg; break;
+
+			case OP_NEG:
+			case OP_NOT:
+				pop = 1; push = 1; break;
+
+			case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MODULO:
+			case OP_BITOR: case OP_BITAND: case OP_BITXOR: case OP_SHL: case OP_SHR:
+			case OP_AND: case OP_OR:
+			case OP_EQ: case OP_NEQ: case OP_LT: case OP_GT: case OP_LE: case OP_GE:
+				pop = 2; push = 1; break;
+
+			case OP_MCALL: pop = code[i-1].arg + 3; push = 1; break; // func, self, args, argc
+			case OP_TAILCALL:
+				pop = code[i-1].arg + 3;
+				if (d != pop) fail(i, "unbalanced stack at tail call");
+				fallthrough = false; break;
+			case OP_RET:
+				if (d != 1) fail(i, "unbalanced stack at return");
+				pop = 1; fallthrough = false; break;
+			case OP_YIELD: pop = 1; break;
+
+			case OP_JMP: fallthrough = false; break;
+			case OP_JMPT:
+			case OP_JMPF:
+			case OP_JMP0:
+				pop = 1; break;
+
+			case OP_RANGEPREP:
+			case OP_RANGELOOP:
+				if (d < 2) fail(i, "stack underflow");
+				break;
+			case OP_TABLOOP:
+				if (d < 2) fail(i, "stack underflow");
+				push_taken = 2; break;
+
+			default: fail(i, "unknown opcode");
+		}
+
+		if (pop > d) fail(i, "stack underflow");
+		d += push - pop;
+		if (d + push_taken > max_depth) max_depth = d + push_taken;
+
+		// successors
+		size_t next[2]; int next_depth[2]; int num_next = 0;
+		if (fallthrough)
+		{
+			if (i+1 >= n) fail(i, "execution runs past the end of the function");
+			next[num_next] = i+1; next_depth[num_next++] = d;
+		}
+		if (isJumpOpcode(inst.op))
+		{
+			next[num_next] = size_t(inst.arg); next_depth[num_next++] = d + push_taken;
+		}
+
+		for (int k=0; k<num_next; ++k)
+		{
+			size_t j = next[k];
+			if (depth[j] == -1)
+			{
+				depth[j] = next_depth[k]; locals[j] = l;
+				todo.push_back(j);
+			} else if ((depth[j] != next_depth[k]) || (locals[j] != l)) {
+				fail(j, "inconsistent stack or local variables");
+			}
+		}
+	}
+
+	fn->max_stack = max_depth;
+}
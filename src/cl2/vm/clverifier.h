@@ -0,0 +1,36 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef CLVERIFIER_H
+#define CLVERIFIER_H
+
+class CLFunction;
+
+// Bytecode verifier. Checks opcodes, arguments, jump targets, local variable
+// indices and the stack balance of every path through a function, and computes
+// the maximum operand stack depth (CLFunction::max_stack). Threads reserve that
+// much stack on each call, so the interpreter doesn't need any bounds checks.
+class CLVerifier
+{
+public:
+	static void verify(CLFunction *fn); // throws std::runtime_error if fn is invalid
+};
+
+#endif
@@ -0,0 +1,182 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "clworkercontext.h"
+#include "clthread.h"
+
+#include "../value/clarray.h"
+#include "../value/clfunction.h"
+#include "../value/cltable.h"
+
+#include "../serialize/clserialloader.h"
+#include "../serialize/clserialsaver.h"
+
+#include <chrono>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+CLWorkerContext::CLWorkerContext()
+{
+	addModule(&math);
+}
+
+CLWorkerContext::~CLWorkerContext()
+{
+	shutdown(); // before the math module goes
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Spawn                                                                      //
+////////////////////////////////////////////////////////////////////////////////
+
+CLValue CLWorkerContext::spawn(CLContext *context, CLValue fn, std::vector<CLValue> &args, CLValue self)
+{
+	// message: args..., fn, self
+	std::vector<CLValue> values(args);
+	values.push_back(fn);
+	values.push_back(self);
+	std::string data = pack(values);
+
+	// a thread of its own: the script may run for long or wait, and the shared workers are
+	// needed for I/O like savegames
+	return context->asyncThread([context, data]() -> CLWorkerPool::Completion {
+		std::string result;
+		{
+			CLWorkerContext worker;
+			std::vector<CLValue> values = unpack(&worker, data);
+			CLValue self = values.back(); values.pop_back();
+			CLValue fn = values.back(); values.pop_back();
+
+			CLValue thread = CLValue(new CLThread(&worker));
+			GET_THREAD(thread)->init(fn, values, self);
+			worker.runThread(GET_THREAD(thread), context);
+			if (GET_THREAD(thread)->fatalErrorOccured()) throw std::runtime_error(GET_THREAD(thread)->getErrorString());
+
+			std::vector<CLValue> message(1, GET_THREAD(thread)->getResult());
+			result = pack(message);
+		}
+
+		return [result](CLContext *context) { return unpack(context, result)[0]; };
+	});
+}
+
+void CLWorkerContext::runThread(CLThread *thread, CLContext *parent)
+{
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point last_tick = Clock::now();
+
+	for (unsigned round = 1; thread->isRunning(); ++round)
+	{
+		if (parent->jobsCancelled()) throw std::runtime_error("Worker context cancelled");
+
+		// the clock follows real time
+		unsigned long ms = (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - last_tick).count();
+		if (ms > 0)
+		{
+			tick(ms);
+			last_tick += std::chrono::milliseconds(ms);
+		}
+		completeJobs();
+
+		if (hasReadyThreads())
+			schedule(10000); // slices, so a busy thread still notices cancellation
+		else
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		if (round % 100 == 0)
+		{
+			unmarkObjects();
+			markObjects();
+			sweepObjects();
+			finalizeObjects();
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Deep copies                                                                //
+////////////////////////////////////////////////////////////////////////////////
+
+static void checkCopyable(CLValue value, std::set<CLObject*> &seen)
+{
+	if (!value.isObject() || !seen.insert(GET_OBJECT(value)).second) return;
+
+	switch (value.type)
+	{
+		case CL_TABLE:
+		{
+			CLTable *table = GET_TABLE(value);
+			checkCopyable(table->getParent(), seen);
+
+			CLValue key, val;
+			for (CLValue it = table->begin(); !it.isNull(); )
+			{
+				it = table->next(it, key, val);
+				checkCopyable(key, seen);
+				checkCopyable(val, seen);
+			}
+			break;
+		}
+
+		case CL_ARRAY:
+		{
+			CLArray *array = GET_ARRAY(value);
+			for (size_t i=0; i<array->size(); ++i) checkCopyable(array->at(i), seen);
+			break;
+		}
+
+		case CL_FUNCTION:
+		{
+			CLFunction *fn = GET_FUNCTION(value);
+			for (size_t i=0; i<fn->constants.size(); ++i) checkCopyable(fn->constants[i], seen);
+			break;
+		}
+
+		case CL_STRING:
+		case CL_EXTERNALFUNCTION:
+			break;
+
+		default:
+			throw std::runtime_error("Can't copy " + value.typeString() + " to another context");
+	}
+}
+
+std::string CLWorkerContext::pack(std::vector<CLValue> &values)
+{
+	std::set<CLObject*> seen;
+	for (size_t i=0; i<values.size(); ++i) checkCopyable(values[i], seen);
+
+	std::stringstream ss;
+	{
+		CLSerialSaver S(ss);
+		CLValue::saveVector(S, values);
+		S.finish();
+	}
+	return ss.str();
+}
+
+std::vector<CLValue> CLWorkerContext::unpack(CLContext *context, const std::string &data)
+{
+	std::stringstream ss(data);
+	CLSerialLoader L(ss, context);
+	return CLValue::loadVector(L);
+}
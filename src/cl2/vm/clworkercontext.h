@@ -0,0 +1,55 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef CLWORKERCONTEXT_H
+#define CLWORKERCONTEXT_H
+
+#include "clcontext.h"
+#include "clmathmodule.h"
+
+#include <string>
+#include <vector>
+
+// A context of its own for pure computation on a worker thread (see sys.spawn). It shares
+// nothing with the context that spawned it and has only the thread-safe modules (sys, math).
+// Values move between the contexts as deep copies made with the serializer; data and script
+// functions can be copied, threads, futures and userdata (engine objects) can't.
+class CLWorkerContext : public CLContext
+{
+public:
+	CLWorkerContext();
+	~CLWorkerContext();
+
+	// Run fn(args) with self in a new worker context, return a future of a copy of its result
+	// (throws std::runtime_error if a value can't be copied)
+	static CLValue spawn(CLContext *context, CLValue fn, std::vector<CLValue> &args, CLValue self);
+
+	// Deep copies
+	static std::string pack(std::vector<CLValue> &values); // throws std::runtime_error
+	static std::vector<CLValue> unpack(CLContext *context, const std::string &data);
+
+private:
+	CLMathModule math;
+
+	// run thread to completion, stop when parent cancels its jobs
+	void runThread(CLThread *thread, CLContext *parent);
+};
+
+#endif
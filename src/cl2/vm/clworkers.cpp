@@ -0,0 +1,149 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "clworkers.h"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+CLWorkerPool::CLWorkerPool()
+	: busy(0), quit(false), cancelled(false)
+{
+}
+
+CLWorkerPool::~CLWorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	work_cond.notify_all();
+	for (size_t i=0; i<workers.size(); ++i) workers[i].join();
+	for (size_t i=0; i<threads.size(); ++i) threads[i].join();
+}
+
+void CLWorkerPool::push(unsigned long id, Job job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (workers.empty())
+		{
+			// leave one core to the main thread
+			unsigned n = std::thread::hardware_concurrency();
+			n = std::max(1u, std::min(4u, n > 1 ? n-1 : 1u));
+			for (unsigned i=0; i<n; ++i) workers.push_back(std::thread(&CLWorkerPool::work, this));
+		}
+		jobs.push_back(std::make_pair(id, job));
+	}
+	work_cond.notify_one();
+}
+
+void CLWorkerPool::pushThread(unsigned long id, Job job)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	joinExited();
+	++busy;
+	threads.push_back(std::thread(&CLWorkerPool::runThread, this, id, job));
+}
+
+bool CLWorkerPool::pop(unsigned long &id, Completion &completion)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (finished.empty()) return false;
+
+	id = finished.front().first;
+	completion = finished.front().second;
+	finished.pop_front();
+	return true;
+}
+
+void CLWorkerPool::wait(bool cancel)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (cancel) cancelled = true;
+	while (!jobs.empty() || (busy > 0)) idle_cond.wait(lock);
+	cancelled = false;
+}
+
+void CLWorkerPool::waitFinished()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (finished.empty() && (!jobs.empty() || (busy > 0))) idle_cond.wait(lock);
+}
+
+void CLWorkerPool::work()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		while (jobs.empty() && !quit) work_cond.wait(lock);
+		if (jobs.empty()) return; // quit, nothing left to do
+
+		std::pair<unsigned long, Job> job = jobs.front();
+		jobs.pop_front();
+		++busy;
+		lock.unlock();
+
+		Completion completion = run(job.second);
+
+		lock.lock();
+		finished.push_back(std::make_pair(job.first, completion));
+		--busy;
+		idle_cond.notify_all(); // (waitFinished waits for any job, wait for the last one)
+	}
+}
+
+void CLWorkerPool::runThread(unsigned long id, Job job)
+{
+	Completion completion = run(job);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	finished.push_back(std::make_pair(id, completion));
+	--busy;
+	exited.push_back(std::this_thread::get_id());
+	idle_cond.notify_all();
+}
+
+void CLWorkerPool::joinExited()
+{
+	for (size_t i=0; i<exited.size(); ++i)
+	{
+		for (size_t j=0; j<threads.size(); ++j)
+		{
+			if (threads[j].get_id() != exited[i]) continue;
+			threads[j].join(); // (it's only returning)
+			threads.erase(threads.begin() + j);
+			break;
+		}
+	}
+	exited.clear();
+}
+
+CLWorkerPool::Completion CLWorkerPool::run(Job &job)
+{
+	try {
+		return job();
+	} catch (std::exception &e) {
+		std::string err = e.what();
+		return [err](CLContext *) -> CLValue { throw std::runtime_error(err); };
+	}
+}
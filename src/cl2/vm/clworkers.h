@@ -0,0 +1,77 @@
+/*
+    This file is part of the CL2 script language interpreter.
+
+    Gunnar Selke <gunnar@gmx.info>
+
+    CL2 is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    CL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CL2; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef CLWORKERS_H
+#define CLWORKERS_H
+
+#include "../value/clvalue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Runs native jobs in background threads (see CLContext::async). A job must not touch
+// script values: it runs in a worker and returns a completion, which CLContext calls in
+// the main thread to turn the job's output into the future's result.
+// Short jobs (I/O, searches) share a few worker threads. Jobs that may run or block for
+// long (worker contexts, see sys.spawn) get a thread of their own, so they never hold up
+// the shared ones.
+class CLWorkerPool
+{
+public:
+	typedef std::function<CLValue(class CLContext *)> Completion; // main thread
+	typedef std::function<Completion()> Job;                      // worker thread
+
+	CLWorkerPool();
+	~CLWorkerPool(); // waits for running jobs
+
+	void push(unsigned long id, Job job);
+	void pushThread(unsigned long id, Job job);          // run job in a thread of its own
+	bool pop(unsigned long &id, Completion &completion); // a finished job, false if there is none
+	void wait(bool cancel = false);                      // until all pushed jobs have finished
+	void waitFinished();                                 // until there is a finished job (or none left to run)
+
+	// Long running jobs should poll this and give up (throw) when it's set
+	bool isCancelled() const { return cancelled; }
+
+private:
+	std::vector<std::thread> workers; // started with the first job
+	std::vector<std::thread> threads; // of pushThread jobs
+	std::vector<std::thread::id> exited; // threads that are done and can be joined
+	std::mutex mutex;
+	std::condition_variable work_cond, idle_cond;
+	std::deque<std::pair<unsigned long, Job> > jobs;
+	std::deque<std::pair<unsigned long, Completion> > finished;
+	size_t busy;
+	bool quit;
+	std::atomic<bool> cancelled; // set while wait(true) is waiting
+
+	void work();
+	void runThread(unsigned long id, Job job);
+	void joinExited(); // (with mutex locked)
+	static Completion run(Job &job);
+};
+
+#endif
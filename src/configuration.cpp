@@ -100,6 +100,14 @@ void Configuration::Parse(const std::string &config_file) {
                 return;
             }
             sources.emplace_back(path);
+        } else if (v == "boot-image") {
+            const char *path = child->Attribute("path");
+            if (!path) {
+                error_string = "Missing 'path' argument in <boot-image> element.";
+                err = true;
+                return;
+            }
+            boot_image = path;
         }
 
         child = child->NextSiblingElement();
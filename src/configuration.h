@@ -33,6 +33,7 @@ public:
 
 	const std::string &GetTitle() { return title; }
 	const std::string &GetSceneFile() { return scene_file; }
+	const std::string &GetBootImage() { return boot_image; } // "" if disabled
 
 	void GetVideoSettings(int &width, int &height, bool &fullscreen);
 	int  GetVideoHeight() { return video.height; }
@@ -52,6 +53,7 @@ private:
 
     std::string title;
     std::string scene_file;
+    std::string boot_image;
     std::vector<std::string> sources;
 
     bool err;
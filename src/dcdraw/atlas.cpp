@@ -0,0 +1,243 @@
+#include "atlas.h"
+#include "batch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace DCDraw
+{
+	// defined in opengl_drv.cpp
+	extern int max_texture_size;
+
+	static const int PAGE_SIZE = 1024;   // (or max_texture_size, if smaller)
+	static const int BORDER    = 1;      // copied edge pixels around every image
+	static const int SHELF_ALIGN = 4;    // shelf heights are rounded up to this
+
+	struct Span
+	{
+		int x, w;
+	};
+
+	struct Shelf
+	{
+		int y, h;
+		std::vector<Span> free; // sorted by x
+	};
+
+	struct Page
+	{
+		GLuint tex_id;         // 0: unused slot
+		int top;               // first row not taken by a shelf
+		int images;
+		std::vector<Shelf> shelves;
+	};
+
+	static std::vector<Page> pages;
+
+	static int GetPageSize()
+	{
+		if (max_texture_size > 0 && max_texture_size < PAGE_SIZE) return max_texture_size;
+		return PAGE_SIZE;
+	}
+
+	static bool AtlasAccepts(int width, int height)
+	{
+		// Wide but low images (like glyph strips of a font) pack well into a shelf of their own,
+		// high ones don't gain much and would waste whole shelves
+		const int size = GetPageSize();
+		return (width > 0) && (height > 0) && (width <= size - 2*BORDER) && (height <= size/4 - 2*BORDER);
+	}
+
+	// Take w pixels from the first span of the shelf that is wide enough, returns x or -1
+	static int TakeSpan(Shelf &shelf, int w)
+	{
+		for (size_t i=0; i<shelf.free.size(); ++i)
+		{
+			Span &span = shelf.free[i];
+			if (span.w < w) continue;
+
+			int x = span.x;
+			span.x += w;
+			span.w -= w;
+			if (span.w == 0) shelf.free.erase(shelf.free.begin() + i);
+			return x;
+		}
+		return -1;
+	}
+
+	static void GiveSpan(Shelf &shelf, int x, int w)
+	{
+		std::vector<Span>::iterator it = shelf.free.begin();
+		while (it != shelf.free.end() && it->x < x) ++it;
+		it = shelf.free.insert(it, Span());
+		it->x = x;
+		it->w = w;
+
+		// merge with the following and the preceding span
+		if (it + 1 != shelf.free.end() && it->x + it->w == (it+1)->x)
+		{
+			it->w += (it+1)->w;
+			shelf.free.erase(it + 1);
+		}
+		if (it != shelf.free.begin() && (it-1)->x + (it-1)->w == it->x)
+		{
+			(it-1)->w += it->w;
+			shelf.free.erase(it);
+		}
+	}
+
+	static void CreatePage(Page &page, int size)
+	{
+		page.top = 0;
+		page.images = 0;
+		page.shelves.clear();
+
+		glGenTextures(1, &page.tex_id);
+		BindTexture    (page.tex_id);
+		glTexImage2D   (GL_TEXTURE_2D, 0, 4, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	}
+
+	// Find a spot for a w*h block (border included)
+	static bool Allocate(int w, int h, AtlasRegion &region)
+	{
+		const int size = GetPageSize();
+
+		// 1. a free span in an existing shelf that isn't much higher than needed
+		int best_page = -1, best_shelf = -1, best_h = 0;
+		for (size_t p=0; p<pages.size(); ++p)
+		{
+			Page &page = pages[p];
+			if (page.tex_id == 0) continue;
+
+			for (size_t s=0; s<page.shelves.size(); ++s)
+			{
+				Shelf &shelf = page.shelves[s];
+				if (shelf.h < h || shelf.h > h + h/4 + SHELF_ALIGN) continue;
+				if (best_page >= 0 && shelf.h >= best_h) continue;
+
+				for (size_t i=0; i<shelf.free.size(); ++i)
+				{
+					if (shelf.free[i].w < w) continue;
+					best_page = (int)p;
+					best_shelf = (int)s;
+					best_h = shelf.h;
+					break;
+				}
+			}
+		}
+
+		// 2. a new shelf in a page with room left, 3. a new page
+		if (best_page < 0)
+		{
+			int shelf_h = (h + SHELF_ALIGN - 1) / SHELF_ALIGN * SHELF_ALIGN;
+
+			for (size_t p=0; p<pages.size() && best_page < 0; ++p)
+			{
+				if (pages[p].tex_id != 0 && pages[p].top + shelf_h <= size) best_page = (int)p;
+			}
+
+			if (best_page < 0)
+			{
+				for (size_t p=0; p<pages.size() && best_page < 0; ++p)
+				{
+					if (pages[p].tex_id == 0) best_page = (int)p;
+				}
+				if (best_page < 0)
+				{
+					best_page = (int)pages.size();
+					pages.push_back(Page());
+				}
+				CreatePage(pages[best_page], size);
+			}
+
+			Page &page = pages[best_page];
+			Shelf shelf;
+			shelf.y = page.top;
+			shelf.h = shelf_h;
+			Span span = { 0, size };
+			shelf.free.push_back(span);
+			page.shelves.push_back(shelf);
+			page.top += shelf_h;
+			best_shelf = (int)page.shelves.size() - 1;
+		}
+
+		Page &page = pages[best_page];
+		Shelf &shelf = page.shelves[best_shelf];
+		region.tex_id = page.tex_id;
+		region.tex_size = size;
+		region.page = best_page;
+		region.shelf = best_shelf;
+		region.x = TakeSpan(shelf, w) + BORDER;
+		region.y = shelf.y + BORDER;
+		++page.images;
+		return true;
+	}
+
+	bool AtlasAdd(Canvas &canvas, AtlasRegion &region)
+	{
+		if (!AtlasAccepts(canvas.GetWidth(), canvas.GetHeight())) return false;
+
+		Canvas src_canvas = canvas;
+		if (src_canvas.GetFormat() != Canvas::RGBA) src_canvas = src_canvas.Convert(Canvas::RGBA);
+
+		const int w = src_canvas.GetWidth(), h = src_canvas.GetHeight();
+		const int bw = w + 2*BORDER, bh = h + 2*BORDER;
+		if (!Allocate(bw, bh, region)) return false;
+		region.w = w;
+		region.h = h;
+
+		// Copy image with its edge pixels repeated into the border
+		std::vector<unsigned char> rgba(bw * bh * 4);
+		for (int y=0; y<bh; ++y)
+		{
+			int sy = std::min(std::max(y - BORDER, 0), h - 1);
+			const unsigned char *src = src_canvas.GetData() + sy * src_canvas.GetPitch();
+			unsigned char *dst = &rgba[y * bw * 4];
+
+			for (int b=0; b<BORDER; ++b) memcpy(dst + b*4, src, 4);
+			memcpy(dst + BORDER*4, src, w * 4);
+			for (int b=0; b<BORDER; ++b) memcpy(dst + (BORDER + w + b)*4, src + (w-1)*4, 4);
+		}
+
+		// Upload just this part of the page
+		FlushBatch(); // (queued quads may sample the page)
+		BindTexture(region.tex_id);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, region.x - BORDER, region.y - BORDER, bw, bh,
+		                GL_RGBA, GL_UNSIGNED_BYTE, &rgba[0]);
+		return true;
+	}
+
+	void AtlasRemove(const AtlasRegion &region)
+	{
+		if (region.page < 0 || region.page >= (int)pages.size()) return;
+		Page &page = pages[region.page];
+		if (page.tex_id != region.tex_id) return; // (page was deleted meanwhile)
+
+		Shelf &shelf = page.shelves[region.shelf];
+		GiveSpan(shelf, region.x - BORDER, region.w + 2*BORDER);
+
+		// Last image of the page gone: delete the texture. Otherwise drop empty shelves at the top
+		if (--page.images == 0)
+		{
+			DeleteTexture(page.tex_id);
+			page.tex_id = 0;
+			page.shelves.clear();
+			page.top = 0;
+			return;
+		}
+
+		const int size = region.tex_size;
+		while (!page.shelves.empty())
+		{
+			Shelf &last = page.shelves.back();
+			if (last.free.size() != 1 || last.free[0].w != size) break;
+			page.top = last.y;
+			page.shelves.pop_back();
+		}
+	}
+}
@@ -0,0 +1,34 @@
+#ifndef DCDRAW_ATLAS_H
+#define DCDRAW_ATLAS_H
+
+#if defined(__APPLE__) && defined(__DARWIN__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include "canvas.h"
+
+namespace DCDraw
+{
+	// Small images (sprite frames, glyphs, ...) are packed into shared textures ("pages"),
+	// so the batch can draw many of them with one texture bind.
+	// Each page is split into shelves (rows) of similar height; an image takes a span of a
+	// shelf, and removing it gives the span back so later images of that height can reuse it.
+	// Images are stored with a 1 pixel border copied from their edge pixels, so filtering
+	// never samples a neighbour.
+	struct AtlasRegion
+	{
+		GLuint tex_id;    // page texture
+		int tex_size;     // page width and height
+		int x, y;         // position of the image (without border) in the page
+		int w, h;         // image size
+		int page, shelf;  // (for AtlasRemove)
+	};
+
+	// Copy canvas into a free spot of some page, returns false if it is too big for the atlas
+	bool AtlasAdd(Canvas &canvas, AtlasRegion &region);
+	void AtlasRemove(const AtlasRegion &region);
+}
+
+#endif
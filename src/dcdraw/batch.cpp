@@ -0,0 +1,157 @@
+#include "batch.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace DCDraw
+{
+	// how many runs back a quad may join a run of its texture
+	static const size_t MAX_LOOKBACK = 16;
+
+	struct Run
+	{
+		GLuint tex_id;
+		float x1, y1, x2, y2; // bounding box of the quads
+		std::vector<BatchVertex> vertices;
+	};
+
+	static std::vector<Run> runs; // (kept between frames, so the vertex arrays keep their capacity)
+	static size_t num_runs = 0;
+
+	static GLuint bound_texture = 0;
+	static int texturing = -1;    // unknown
+	static bool client_arrays = false;
+
+	void BindTexture(GLuint tex_id)
+	{
+		if (tex_id == bound_texture) return;
+		glBindTexture(GL_TEXTURE_2D, tex_id);
+		bound_texture = tex_id;
+	}
+
+	void DeleteTexture(GLuint tex_id)
+	{
+		for (size_t r=0; r<num_runs; ++r)
+		{
+			if (runs[r].tex_id == tex_id)
+			{
+				FlushBatch();
+				break;
+			}
+		}
+
+		glDeleteTextures(1, &tex_id);
+		if (bound_texture == tex_id) bound_texture = 0; // (GL binds 0 then)
+	}
+
+	void EnableTexturing(bool enable)
+	{
+		if (texturing == (enable ? 1 : 0)) return;
+		if (enable) glEnable(GL_TEXTURE_2D);
+		else glDisable(GL_TEXTURE_2D);
+		texturing = enable ? 1 : 0;
+	}
+
+	static bool Overlaps(const Run &run, float x1, float y1, float x2, float y2)
+	{
+		return (x1 < run.x2) && (run.x1 < x2) && (y1 < run.y2) && (run.y1 < y2);
+	}
+
+	// Run the quads in bounding box (x1, y1)-(x2, y2) are appended to
+	static Run &FindRun(GLuint tex_id, float x1, float y1, float x2, float y2)
+	{
+		size_t target = num_runs;
+		for (size_t r=num_runs; (r > 0) && (num_runs - r < MAX_LOOKBACK); --r)
+		{
+			const Run &run = runs[r-1];
+			if (run.tex_id == tex_id)
+			{
+				target = r-1;
+				break;
+			}
+			if (Overlaps(run, x1, y1, x2, y2)) break; // must be drawn after this one
+		}
+
+		if (target == num_runs)
+		{
+			if (runs.size() == num_runs) runs.push_back(Run());
+			Run &run = runs[num_runs++];
+			run.tex_id = tex_id;
+			run.x1 = x1; run.y1 = y1;
+			run.x2 = x2; run.y2 = y2;
+		}
+
+		Run &run = runs[target];
+		if (x1 < run.x1) run.x1 = x1;
+		if (y1 < run.y1) run.y1 = y1;
+		if (x2 > run.x2) run.x2 = x2;
+		if (y2 > run.y2) run.y2 = y2;
+		return run;
+	}
+
+	void BatchQuad(GLuint tex_id, const BatchVertex quad[4])
+	{
+		float x1 = quad[0].x, y1 = quad[0].y, x2 = x1, y2 = y1;
+		for (int i=1; i<4; ++i)
+		{
+			if (quad[i].x < x1) x1 = quad[i].x;
+			if (quad[i].x > x2) x2 = quad[i].x;
+			if (quad[i].y < y1) y1 = quad[i].y;
+			if (quad[i].y > y2) y2 = quad[i].y;
+		}
+
+		Run &run = FindRun(tex_id, x1, y1, x2, y2);
+		run.vertices.insert(run.vertices.end(), quad, quad + 4);
+	}
+
+	void BatchQuads(GLuint tex_id, const BatchVertex *vertices, size_t num_vertices, const float bbox[4],
+	                float dx, float dy, const Color &col)
+	{
+		if (num_vertices == 0) return;
+
+		Run &run = FindRun(tex_id, bbox[0] + dx, bbox[1] + dy, bbox[2] + dx, bbox[3] + dy);
+		size_t first = run.vertices.size();
+		run.vertices.resize(first + num_vertices);
+
+		BatchVertex *dst = &run.vertices[first];
+		for (size_t i=0; i<num_vertices; ++i)
+		{
+			dst[i].x = vertices[i].x + dx;
+			dst[i].y = vertices[i].y + dy;
+			dst[i].u = vertices[i].u;
+			dst[i].v = vertices[i].v;
+			dst[i].r = col.r; dst[i].g = col.g; dst[i].b = col.b; dst[i].a = col.a;
+		}
+	}
+
+	void FlushBatch()
+	{
+		if (num_runs == 0) return;
+
+		EnableTexturing(true);
+		if (!client_arrays)
+		{
+			// (immediate mode drawing doesn't care, so these stay enabled)
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+			glEnableClientState(GL_COLOR_ARRAY);
+			client_arrays = true;
+		}
+
+		for (size_t r=0; r<num_runs; ++r)
+		{
+			Run &run = runs[r];
+			const BatchVertex *v = &run.vertices[0];
+
+			BindTexture(run.tex_id);
+			glVertexPointer  (2, GL_FLOAT,         sizeof(BatchVertex), &v->x);
+			glTexCoordPointer(2, GL_FLOAT,         sizeof(BatchVertex), &v->u);
+			glColorPointer   (4, GL_UNSIGNED_BYTE, sizeof(BatchVertex), &v->r);
+			glDrawArrays(GL_QUADS, 0, (GLsizei)run.vertices.size());
+
+			run.vertices.clear();
+		}
+
+		num_runs = 0;
+	}
+}
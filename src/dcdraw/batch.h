@@ -0,0 +1,41 @@
+#ifndef DCDRAW_BATCH_H
+#define DCDRAW_BATCH_H
+
+#if defined(__APPLE__) && defined(__DARWIN__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <cstddef>
+
+#include "color.h"
+
+namespace DCDraw
+{
+	struct BatchVertex
+	{
+		GLfloat x, y;
+		GLfloat u, v;
+		GLubyte r, g, b, a;
+	};
+
+	// Textured quads (already transformed) are collected into runs per texture and drawn with
+	// one glDrawArrays per run. A quad joins an earlier run of its texture if it doesn't overlap
+	// anything drawn after that run, so the result looks the same as drawing in order.
+	// The batch is flushed before any other drawing or state change, and at EndFrame.
+	void BatchQuad(GLuint tex_id, const BatchVertex quad[4]);
+
+	// Prepared quads (see Mesh) as one block: moved by (dx, dy) and tinted with col.
+	// bbox = {x1, y1, x2, y2} of the untranslated vertices
+	void BatchQuads(GLuint tex_id, const BatchVertex *vertices, size_t num_vertices, const float bbox[4],
+	                float dx, float dy, const Color &col);
+	void FlushBatch();
+
+	// GL state cache, use these instead of calling GL directly
+	void BindTexture(GLuint tex_id);
+	void DeleteTexture(GLuint tex_id); // flushes quads still using it
+	void EnableTexturing(bool enable);
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "canvas.h"
+#include "canvas_convert.h"
 
 #include <iostream>
 
@@ -66,6 +67,17 @@ namespace DCDraw {
         return clone;
     }
 
+    // 16 bit pixel through the conversion kernels, so both give the same colors
+    template<class PixelFormat>
+    static void LoadPixel(const unsigned char *p, unsigned char &r, unsigned char &g, unsigned char &b, unsigned char &a) {
+        Scalar::V r32, g32, b32, a32;
+        PixelFormat::template Load<Scalar>(p, r32, g32, b32, a32);
+        r = (unsigned char) r32;
+        g = (unsigned char) g32;
+        b = (unsigned char) b32;
+        a = (unsigned char) a32;
+    }
+
     bool Canvas::HasAlpha() {
         if (bitmap.get()) {
             switch (bitmap->fmt) {
@@ -86,32 +98,17 @@ namespace DCDraw {
     void Canvas::GetPixel(int x, int y, unsigned char &r, unsigned char &g, unsigned char &b, unsigned char &a) {
         unsigned char *row = bitmap->data + y * bitmap->pitch;
         switch (bitmap->fmt) {
-            case RGBA4444: {
-                auto *pix = (unsigned short *) &row[x * 2]; //FIXME: typedef a 16 bit type
-                r = (unsigned char) (255.f * ((*pix & 0xf000) >> 12) / 16.f);
-                g = (unsigned char) (255.f * ((*pix & 0x0f00) >> 8) / 16.f);
-                b = (unsigned char) (255.f * ((*pix & 0x00f0) >> 4) / 16.f);
-                a = (unsigned char) (255.f * ((*pix & 0x000f)) / 16.f);
+            case RGBA4444:
+                LoadPixel<FormatRGBA4444>(&row[x * 2], r, g, b, a);
                 break;
-            }
 
-            case ARGB4444: {
-                auto *pix = (unsigned short *) &row[x * 2]; //FIXME: typedef a 16 bit type
-                a = (unsigned char) (255.f * ((*pix & 0xf000) >> 12) / 16.f);
-                r = (unsigned char) (255.f * ((*pix & 0x0f00) >> 8) / 16.f);
-                g = (unsigned char) (255.f * ((*pix & 0x00f0) >> 4) / 16.f);
-                b = (unsigned char) (255.f * ((*pix & 0x000f)) / 16.f);
+            case ARGB4444:
+                LoadPixel<FormatARGB4444>(&row[x * 2], r, g, b, a);
                 break;
-            }
 
-            case RGB565: {
-                auto *pix = (unsigned short *) &row[x * 2]; //FIXME: typedef a 16 bit type
-                r = (unsigned char) (255.f * ((*pix & 0xf800) >> 11) / 31.f);
-                g = (unsigned char) (255.f * ((*pix & 0x07e0) >> 5) / 63.f);
-                b = (unsigned char) (255.f * ((*pix & 0x001f)) / 31.f);
-                a = 255;
+            case RGB565:
+                LoadPixel<FormatRGB565>(&row[x * 2], r, g, b, a);
                 break;
-            }
 
             case RGB:
                 r = row[x * 3 + 0];
@@ -142,31 +139,17 @@ namespace DCDraw {
 
         unsigned char *row = bitmap->data + y * bitmap->pitch;
         switch (bitmap->fmt) {
-            case ARGB4444: {
-                auto *pix = (unsigned short *) &row[x * 2]; //FIXME: typedef a 16 bit type
-                *pix = ((unsigned short) (16.f * a / 255.f) << 12) & 0xf000
-                       | ((unsigned short) (16.f * r / 255.f) << 8) & 0x0f00
-                       | ((unsigned short) (16.f * g / 255.f) << 4) & 0x00f0
-                       | ((unsigned short) (16.f * b / 255.f)) & 0x000f;
+            case ARGB4444:
+                FormatARGB4444::Store<Scalar>(&row[x * 2], r, g, b, a);
                 break;
-            }
 
-            case RGBA4444: {
-                auto *pix = (unsigned short *) &row[x * 2]; //FIXME: typedef a 16 bit type
-                *pix = ((unsigned short) (16.f * r / 255.f) << 12) & 0xf000
-                       | ((unsigned short) (16.f * g / 255.f) << 8) & 0x0f00
-                       | ((unsigned short) (16.f * b / 255.f) << 4) & 0x00f0
-                       | ((unsigned short) (16.f * a / 255.f)) & 0x000f;
+            case RGBA4444:
+                FormatRGBA4444::Store<Scalar>(&row[x * 2], r, g, b, a);
                 break;
-            }
 
-            case RGB565: {
-                auto *pix = (unsigned short *) &row[x * 2]; //FIXME: typedef a 16 bit type
-                *pix = ((unsigned short) (31.f * r / 255.f) << 11) & 0xf800
-                       | ((unsigned short) (63.f * g / 255.f) << 5) & 0x07e0
-                       | ((unsigned short) (31.f * b / 255.f)) & 0x001f;
+            case RGB565:
+                FormatRGB565::Store<Scalar>(&row[x * 2], r, g, b, a);
                 break;
-            }
 
             case RGB:
                 row[x * 3 + 0] = r;
@@ -188,6 +171,20 @@ namespace DCDraw {
         }
     }
 
+    // Kernel for this CPU
+    static ConvertRowFunc FindConvertRow(Canvas::Format src, Canvas::Format dst) {
+#ifdef DCDRAW_CONVERT_X86
+        static const bool has_avx2 = __builtin_cpu_supports("avx2");
+        if (has_avx2) {
+            ConvertRowFunc func = GetConvertRowAVX2(src, dst);
+            if (func) return func;
+        }
+        return GetConvertRowSSE2(src, dst);
+#else
+        return GetConvertRow<Scalar>(src, dst);
+#endif
+    }
+
     Canvas Canvas::Convert(Format fmt) {
         if (GetFormat() == fmt) return *this;
 
@@ -195,14 +192,10 @@ namespace DCDraw {
         const int H = GetHeight();
 
         Canvas dst(fmt, W, H);
+        ConvertRowFunc convert = FindConvertRow(GetFormat(), fmt);
         for (int y = 0; y < H; ++y) {
-            for (int x = 0; x < W; ++x) {
-                unsigned char r, g, b, a;
-                GetPixel(x, y, r, g, b, a);
-                dst.SetPixel(x, y, r, g, b, a);
-            }
+            convert(bitmap->data + y * bitmap->pitch, dst.bitmap->data + y * dst.bitmap->pitch, W);
         }
         return dst;
     }
 }
-
@@ -0,0 +1,75 @@
+#include "canvas_convert.h"
+
+#if defined(DCDRAW_CONVERT_X86) && defined(__AVX2__) // (this file is compiled with -mavx2)
+
+#include <immintrin.h>
+
+namespace DCDraw {
+    namespace {
+        struct AVX2 {
+            typedef __m256i V;
+            static const int N = 8;
+
+            static V Set(unsigned int c) { return _mm256_set1_epi32((int) c); }
+            static V And(V a, V b) { return _mm256_and_si256(a, b); }
+            static V Or(V a, V b) { return _mm256_or_si256(a, b); }
+            static V Add(V a, V b) { return _mm256_add_epi32(a, b); }
+            static V Sub(V a, V b) { return _mm256_sub_epi32(a, b); }
+            static V Shl(V a, int n) { return _mm256_slli_epi32(a, n); }
+            static V Shr(V a, int n) { return _mm256_srli_epi32(a, n); }
+
+            static V Load16(const unsigned char *p) {
+                return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) p));
+            }
+
+            static void Store16(unsigned char *p, V v) {
+                // (sign extend, so the signed saturation of packs keeps all 16 bits)
+                v = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+                __m128i lo = _mm256_castsi256_si128(v), hi = _mm256_extracti128_si256(v, 1);
+                _mm_storeu_si128((__m128i *) p, _mm_packs_epi32(lo, hi));
+            }
+
+            static V Load24(const unsigned char *p) {
+                // pixels 0-3 are bytes 0-11 of the low half, pixels 4-7 bytes 4-15 of the high half
+                // (two 16 byte loads, so nothing after the 24 bytes is touched)
+                __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) p)),
+                                                    _mm_loadu_si128((const __m128i *) (p + 8)), 1);
+                const __m256i spread = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                                        4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15, -1);
+                return _mm256_shuffle_epi8(v, spread);
+            }
+
+            static void Store24(unsigned char *p, V v) {
+                const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                                      0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+                v = _mm256_shuffle_epi8(v, pack);
+                __m128i lo = _mm256_castsi256_si128(v), hi = _mm256_extracti128_si256(v, 1);
+
+                int tail;
+                _mm_storel_epi64((__m128i *) p, lo);
+                tail = _mm_cvtsi128_si32(_mm_srli_si128(lo, 8));
+                std::memcpy(p + 8, &tail, 4);
+                _mm_storel_epi64((__m128i *) (p + 12), hi);
+                tail = _mm_cvtsi128_si32(_mm_srli_si128(hi, 8));
+                std::memcpy(p + 20, &tail, 4);
+            }
+
+            static V Load32(const unsigned char *p) { return _mm256_loadu_si256((const __m256i *) p); }
+            static void Store32(unsigned char *p, V v) { _mm256_storeu_si256((__m256i *) p, v); }
+        };
+    }
+
+    ConvertRowFunc GetConvertRowAVX2(Canvas::Format src, Canvas::Format dst) {
+        return GetConvertRow<AVX2>(src, dst);
+    }
+}
+
+#else
+
+namespace DCDraw {
+    ConvertRowFunc GetConvertRowAVX2(Canvas::Format, Canvas::Format) {
+        return nullptr;
+    }
+}
+
+#endif
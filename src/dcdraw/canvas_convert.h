@@ -0,0 +1,255 @@
+#ifndef DCDRAW_CANVAS_CONVERT_H
+#define DCDRAW_CANVAS_CONVERT_H
+
+// Row kernels for Canvas::Convert, one per source/destination format pair.
+//
+// The kernels are written once against an "instruction set" class I, which holds I::N pixels
+// in a vector I::V with one 32-bit lane per pixel and channel, and are instantiated for plain
+// C++ (Scalar, here), SSE2 (canvas_sse2.cpp) and AVX2 (canvas_avx2.cpp, compiled with -mavx2).
+// All of them do the same integer operations, so they give exactly the same result.
+//
+// Everything is in an unnamed namespace: the translation units are compiled with different
+// instruction sets, and the linker must not merge their copies.
+
+#include "canvas.h"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && defined(__GNUC__)
+#define DCDRAW_CONVERT_X86 // SSE2 kernels, AVX2 kernels if the CPU has it
+#endif
+
+namespace DCDraw {
+    typedef void (*ConvertRowFunc)(const unsigned char *src, unsigned char *dst, int width);
+
+    ConvertRowFunc GetConvertRowSSE2(Canvas::Format src, Canvas::Format dst);
+    ConvertRowFunc GetConvertRowAVX2(Canvas::Format src, Canvas::Format dst); // nullptr if not compiled in
+
+    namespace {
+        struct Scalar {
+            typedef unsigned int V;
+            static const int N = 1;
+
+            static V Set(unsigned int c) { return c; }
+            static V And(V a, V b) { return a & b; }
+            static V Or(V a, V b) { return a | b; }
+            static V Add(V a, V b) { return a + b; }
+            static V Sub(V a, V b) { return a - b; }
+            static V Shl(V a, int n) { return a << n; }
+            static V Shr(V a, int n) { return a >> n; }
+
+            static V Load16(const unsigned char *p) {
+                unsigned short pix; // (native byte order, like GetPixel)
+                std::memcpy(&pix, p, 2);
+                return pix;
+            }
+
+            static void Store16(unsigned char *p, V v) {
+                auto pix = (unsigned short) v;
+                std::memcpy(p, &pix, 2);
+            }
+
+            static V Load24(const unsigned char *p) {
+                return p[0] | (p[1] << 8) | (p[2] << 16);
+            }
+
+            static void Store24(unsigned char *p, V v) {
+                p[0] = (unsigned char) v;
+                p[1] = (unsigned char) (v >> 8);
+                p[2] = (unsigned char) (v >> 16);
+            }
+
+            static V Load32(const unsigned char *p) {
+                return p[0] | (p[1] << 8) | (p[2] << 16) | ((V) p[3] << 24);
+            }
+
+            static void Store32(unsigned char *p, V v) {
+                p[0] = (unsigned char) v;
+                p[1] = (unsigned char) (v >> 8);
+                p[2] = (unsigned char) (v >> 16);
+                p[3] = (unsigned char) (v >> 24);
+            }
+        };
+
+        // n bit channel <=> 8 bit channel. Expanding repeats the high bits, reducing rounds
+        // to the nearest value (v * max / 255, the division done exactly with shifts)
+        template<class I>
+        inline typename I::V Expand(typename I::V v, int bits) {
+            return I::Or(I::Shl(v, 8 - bits), I::Shr(v, 2 * bits - 8));
+        }
+
+        template<class I>
+        inline typename I::V Reduce(typename I::V v, int bits) {
+            typename I::V t = I::Add(I::Sub(I::Shl(v, bits), v), I::Set(128));
+            return I::Shr(I::Add(t, I::Shr(t, 8)), 8);
+        }
+
+        struct FormatRGB565 {
+            static const int SIZE = 2;
+
+            template<class I>
+            static void Load(const unsigned char *p, typename I::V &r, typename I::V &g, typename I::V &b, typename I::V &a) {
+                typename I::V v = I::Load16(p);
+                r = Expand<I>(I::Shr(v, 11), 5);
+                g = Expand<I>(I::And(I::Shr(v, 5), I::Set(0x3f)), 6);
+                b = Expand<I>(I::And(v, I::Set(0x1f)), 5);
+                a = I::Set(255);
+            }
+
+            template<class I>
+            static void Store(unsigned char *p, typename I::V r, typename I::V g, typename I::V b, typename I::V) {
+                I::Store16(p, I::Or(I::Or(I::Shl(Reduce<I>(r, 5), 11), I::Shl(Reduce<I>(g, 6), 5)), Reduce<I>(b, 5)));
+            }
+        };
+
+        // 4 bit channels, c1 in the high nibble
+        template<class I>
+        inline void Load4444(const unsigned char *p, typename I::V &c1, typename I::V &c2, typename I::V &c3, typename I::V &c4) {
+            typename I::V v = I::Load16(p), mask = I::Set(0xf);
+            c1 = Expand<I>(I::Shr(v, 12), 4);
+            c2 = Expand<I>(I::And(I::Shr(v, 8), mask), 4);
+            c3 = Expand<I>(I::And(I::Shr(v, 4), mask), 4);
+            c4 = Expand<I>(I::And(v, mask), 4);
+        }
+
+        template<class I>
+        inline void Store4444(unsigned char *p, typename I::V c1, typename I::V c2, typename I::V c3, typename I::V c4) {
+            I::Store16(p, I::Or(I::Or(I::Shl(Reduce<I>(c1, 4), 12), I::Shl(Reduce<I>(c2, 4), 8)),
+                                I::Or(I::Shl(Reduce<I>(c3, 4), 4), Reduce<I>(c4, 4))));
+        }
+
+        struct FormatRGBA4444 {
+            static const int SIZE = 2;
+
+            template<class I>
+            static void Load(const unsigned char *p, typename I::V &r, typename I::V &g, typename I::V &b, typename I::V &a) {
+                Load4444<I>(p, r, g, b, a);
+            }
+
+            template<class I>
+            static void Store(unsigned char *p, typename I::V r, typename I::V g, typename I::V b, typename I::V a) {
+                Store4444<I>(p, r, g, b, a);
+            }
+        };
+
+        struct FormatARGB4444 {
+            static const int SIZE = 2;
+
+            template<class I>
+            static void Load(const unsigned char *p, typename I::V &r, typename I::V &g, typename I::V &b, typename I::V &a) {
+                Load4444<I>(p, a, r, g, b);
+            }
+
+            template<class I>
+            static void Store(unsigned char *p, typename I::V r, typename I::V g, typename I::V b, typename I::V a) {
+                Store4444<I>(p, a, r, g, b);
+            }
+        };
+
+        struct FormatRGB {
+            static const int SIZE = 3;
+
+            template<class I>
+            static void Load(const unsigned char *p, typename I::V &r, typename I::V &g, typename I::V &b, typename I::V &a) {
+                typename I::V v = I::Load24(p), mask = I::Set(0xff);
+                r = I::And(v, mask);
+                g = I::And(I::Shr(v, 8), mask);
+                b = I::Shr(v, 16);
+                a = I::Set(255);
+            }
+
+            template<class I>
+            static void Store(unsigned char *p, typename I::V r, typename I::V g, typename I::V b, typename I::V) {
+                I::Store24(p, I::Or(I::Or(r, I::Shl(g, 8)), I::Shl(b, 16)));
+            }
+        };
+
+        // 8 bit channels in memory order c1, c2, c3, c4
+        template<class I>
+        inline void Load8888(const unsigned char *p, typename I::V &c1, typename I::V &c2, typename I::V &c3, typename I::V &c4) {
+            typename I::V v = I::Load32(p), mask = I::Set(0xff);
+            c1 = I::And(v, mask);
+            c2 = I::And(I::Shr(v, 8), mask);
+            c3 = I::And(I::Shr(v, 16), mask);
+            c4 = I::Shr(v, 24);
+        }
+
+        template<class I>
+        inline void Store8888(unsigned char *p, typename I::V c1, typename I::V c2, typename I::V c3, typename I::V c4) {
+            I::Store32(p, I::Or(I::Or(c1, I::Shl(c2, 8)), I::Or(I::Shl(c3, 16), I::Shl(c4, 24))));
+        }
+
+        struct FormatRGBA {
+            static const int SIZE = 4;
+
+            template<class I>
+            static void Load(const unsigned char *p, typename I::V &r, typename I::V &g, typename I::V &b, typename I::V &a) {
+                Load8888<I>(p, r, g, b, a);
+            }
+
+            template<class I>
+            static void Store(unsigned char *p, typename I::V r, typename I::V g, typename I::V b, typename I::V a) {
+                Store8888<I>(p, r, g, b, a);
+            }
+        };
+
+        struct FormatARGB {
+            static const int SIZE = 4;
+
+            template<class I>
+            static void Load(const unsigned char *p, typename I::V &r, typename I::V &g, typename I::V &b, typename I::V &a) {
+                Load8888<I>(p, a, r, g, b);
+            }
+
+            template<class I>
+            static void Store(unsigned char *p, typename I::V r, typename I::V g, typename I::V b, typename I::V a) {
+                Store8888<I>(p, a, r, g, b);
+            }
+        };
+
+        template<class I, class Src, class Dst>
+        void ConvertRow(const unsigned char *src, unsigned char *dst, int width) {
+            int x = 0;
+            for (; x + I::N <= width; x += I::N) {
+                typename I::V r, g, b, a;
+                Src::template Load<I>(src + x * Src::SIZE, r, g, b, a);
+                Dst::template Store<I>(dst + x * Dst::SIZE, r, g, b, a);
+            }
+
+            // rest of the row
+            for (; x < width; ++x) {
+                Scalar::V r, g, b, a;
+                Src::template Load<Scalar>(src + x * Src::SIZE, r, g, b, a);
+                Dst::template Store<Scalar>(dst + x * Dst::SIZE, r, g, b, a);
+            }
+        }
+
+        template<class I, class Src>
+        ConvertRowFunc GetConvertRowFrom(Canvas::Format dst) {
+            switch (dst) {
+                case Canvas::RGB565:   return &ConvertRow<I, Src, FormatRGB565>;
+                case Canvas::RGBA4444: return &ConvertRow<I, Src, FormatRGBA4444>;
+                case Canvas::ARGB4444: return &ConvertRow<I, Src, FormatARGB4444>;
+                case Canvas::RGB:      return &ConvertRow<I, Src, FormatRGB>;
+                case Canvas::RGBA:     return &ConvertRow<I, Src, FormatRGBA>;
+                case Canvas::ARGB:     return &ConvertRow<I, Src, FormatARGB>;
+            }
+            return nullptr;
+        }
+
+        template<class I>
+        ConvertRowFunc GetConvertRow(Canvas::Format src, Canvas::Format dst) {
+            switch (src) {
+                case Canvas::RGB565:   return GetConvertRowFrom<I, FormatRGB565>(dst);
+                case Canvas::RGBA4444: return GetConvertRowFrom<I, FormatRGBA4444>(dst);
+                case Canvas::ARGB4444: return GetConvertRowFrom<I, FormatARGB4444>(dst);
+                case Canvas::RGB:      return GetConvertRowFrom<I, FormatRGB>(dst);
+                case Canvas::RGBA:     return GetConvertRowFrom<I, FormatRGBA>(dst);
+                case Canvas::ARGB:     return GetConvertRowFrom<I, FormatARGB>(dst);
+            }
+            return nullptr;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,53 @@
+#include "canvas_convert.h"
+
+#ifdef DCDRAW_CONVERT_X86
+
+#include <emmintrin.h>
+
+namespace DCDraw {
+    namespace {
+        struct SSE2 {
+            typedef __m128i V;
+            static const int N = 4;
+
+            static V Set(unsigned int c) { return _mm_set1_epi32((int) c); }
+            static V And(V a, V b) { return _mm_and_si128(a, b); }
+            static V Or(V a, V b) { return _mm_or_si128(a, b); }
+            static V Add(V a, V b) { return _mm_add_epi32(a, b); }
+            static V Sub(V a, V b) { return _mm_sub_epi32(a, b); }
+            static V Shl(V a, int n) { return _mm_slli_epi32(a, n); }
+            static V Shr(V a, int n) { return _mm_srli_epi32(a, n); }
+
+            static V Load16(const unsigned char *p) {
+                return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *) p), _mm_setzero_si128());
+            }
+
+            static void Store16(unsigned char *p, V v) {
+                // (sign extend, so the signed saturation of packs keeps all 16 bits)
+                v = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+                _mm_storel_epi64((__m128i *) p, _mm_packs_epi32(v, v));
+            }
+
+            // 3 byte pixels don't line up with the lanes, SSE2 has no byte shuffle for them
+            static V Load24(const unsigned char *p) {
+                return _mm_setr_epi32((int) Scalar::Load24(p), (int) Scalar::Load24(p + 3),
+                                      (int) Scalar::Load24(p + 6), (int) Scalar::Load24(p + 9));
+            }
+
+            static void Store24(unsigned char *p, V v) {
+                unsigned int pix[4];
+                _mm_storeu_si128((__m128i *) pix, v);
+                for (int i = 0; i < 4; ++i) Scalar::Store24(p + 3 * i, pix[i]);
+            }
+
+            static V Load32(const unsigned char *p) { return _mm_loadu_si128((const __m128i *) p); }
+            static void Store32(unsigned char *p, V v) { _mm_storeu_si128((__m128i *) p, v); }
+        };
+    }
+
+    ConvertRowFunc GetConvertRowSSE2(Canvas::Format src, Canvas::Format dst) {
+        return GetConvertRow<SSE2>(src, dst);
+    }
+}
+
+#endif
@@ -10,6 +10,9 @@
 #include "canvas_png.h"
 
 #include "texture.h"
+#include "atlas.h"
+#include "batch.h"
+#include "mesh.h"
 #include "opengl_drv.h"
 
 namespace DCDraw {
@@ -0,0 +1,45 @@
+#include "mesh.h"
+
+namespace DCDraw
+{
+	void Mesh::AddQuad(GLuint tex_id, const BatchVertex quad[4])
+	{
+		// Quads of a mesh don't overlap (much), so one part per texture is enough
+		Part *part = nullptr;
+		for (size_t p=0; p<parts.size(); ++p)
+		{
+			if (parts[p].tex_id == tex_id)
+			{
+				part = &parts[p];
+				break;
+			}
+		}
+
+		if (!part)
+		{
+			parts.push_back(Part());
+			part = &parts.back();
+			part->tex_id = tex_id;
+			part->bbox[0] = part->bbox[2] = quad[0].x;
+			part->bbox[1] = part->bbox[3] = quad[0].y;
+		}
+
+		for (int i=0; i<4; ++i)
+		{
+			if (quad[i].x < part->bbox[0]) part->bbox[0] = quad[i].x;
+			if (quad[i].y < part->bbox[1]) part->bbox[1] = quad[i].y;
+			if (quad[i].x > part->bbox[2]) part->bbox[2] = quad[i].x;
+			if (quad[i].y > part->bbox[3]) part->bbox[3] = quad[i].y;
+		}
+		part->vertices.insert(part->vertices.end(), quad, quad + 4);
+	}
+
+	void Mesh::Draw(float x, float y, const Color &col)
+	{
+		for (size_t p=0; p<parts.size(); ++p)
+		{
+			Part &part = parts[p];
+			BatchQuads(part.tex_id, &part.vertices[0], part.vertices.size(), part.bbox, x, y, col);
+		}
+	}
+}
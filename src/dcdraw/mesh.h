@@ -0,0 +1,36 @@
+#ifndef DCDRAW_MESH_H
+#define DCDRAW_MESH_H
+
+#include <cstddef>
+#include <vector>
+
+#include "batch.h"
+#include "color.h"
+
+namespace DCDraw
+{
+	// Textured quads recorded once (e.g. a laid out text) and drawn many times,
+	// each time as one block per texture, at any position and in any color
+	class Mesh
+	{
+	public:
+		void Clear() { parts.clear(); }
+		bool IsEmpty() { return parts.empty(); }
+
+		// Add a quad, the color of its vertices is ignored
+		void AddQuad(GLuint tex_id, const BatchVertex quad[4]);
+
+		void Draw(float x, float y, const Color &col);
+
+	private:
+		struct Part
+		{
+			GLuint tex_id;
+			float bbox[4]; // x1, y1, x2, y2
+			std::vector<BatchVertex> vertices;
+		};
+		std::vector<Part> parts; // in drawing order
+	};
+}
+
+#endif
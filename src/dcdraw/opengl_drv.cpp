@@ -1,4 +1,5 @@
 #include "opengl_drv.h"
+#include "batch.h"
 
 #if defined(__APPLE__) && defined(__DARWIN__)
 #include <OpenGL/gl.h>
@@ -40,7 +41,7 @@ namespace DCDraw
 		glMatrixMode(GL_MODELVIEW);
 		glLoadIdentity();
 		
-		glEnable(GL_TEXTURE_2D);
+		EnableTexturing(true);
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 		glDisable(GL_DEPTH_TEST);
@@ -79,6 +80,7 @@ namespace DCDraw
 
 	void ClearScreen()
 	{
+		FlushBatch(); // (keep the order of drawing and clearing)
 		glClear(GL_COLOR_BUFFER_BIT);
 	}
 
@@ -89,10 +91,22 @@ namespace DCDraw
 	
 	void EndFrame()
 	{
+		FlushBatch();
+	}
+
+	void SetViewOffset(float x, float y)
+	{
+		FlushBatch();
+		glMatrixMode(GL_MODELVIEW);
+		glLoadIdentity();
+		glTranslatef(x, y, 0);
 	}
 
 	void DrawPoint(int x, int y, DCDraw::Color &col)
 	{
+		FlushBatch();
+		EnableTexturing(false);
+
 		++x; ++y;
 		glColor4ub(col.r, col.g, col.b, col.a);
 		glBegin(GL_POINTS);
@@ -102,6 +116,9 @@ namespace DCDraw
 
 	void DrawLine(int x1, int y1, int x2, int y2, DCDraw::Color &col)
 	{
+		FlushBatch();
+		EnableTexturing(false);
+
 		glColor4ub(col.r, col.g, col.b, col.a);
 		
 		glBegin(GL_LINES);
@@ -116,6 +133,7 @@ namespace DCDraw
 
 	void OpenGLClipScreen(bool enable)
 	{
+		FlushBatch();
 		if (enable) {
 			glEnable(GL_SCISSOR_TEST);
 		} else {
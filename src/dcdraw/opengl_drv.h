@@ -14,6 +14,9 @@ namespace DCDraw
 	void BeginFrame();
 	void EndFrame();
 	
+	// Translation of everything drawn after this (e.g. the camera's view of a room plane)
+	void SetViewOffset(float x, float y);
+
 	void DrawPoint(int x, int y, DCDraw::Color &col);
 	void DrawLine(int x1, int y1, int x2, int y2, DCDraw::Color &col);
 	
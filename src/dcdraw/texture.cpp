@@ -1,5 +1,7 @@
 #include "texture.h"
+#include "batch.h"
 
+#include <cmath>
 #include <cstring>
 
 namespace DCDraw
@@ -9,12 +11,12 @@ namespace DCDraw
 	extern int max_texture_size;
 	extern int max_rect_texture_size;
 	
-	Texture::Texture() : bound(false)
+	Texture::Texture() : bound(false), in_atlas(false)
 	{
 		Reset();
 	}
 	
-	Texture::Texture(Canvas &canvas) : bound(false)
+	Texture::Texture(Canvas &canvas) : bound(false), in_atlas(false)
 	{
 		Load(canvas);
 	}
@@ -47,6 +49,23 @@ namespace DCDraw
 	{
 		Unbind();
 
+		// Small images share a texture with others
+		if (AtlasAdd(canvas, region))
+		{
+			SubTex sub;
+			sub.tex_id = region.tex_id;
+			sub.tex_w = sub.tex_h = region.tex_size;
+			sub.tex_x = region.x; sub.tex_y = region.y;
+			sub.x = sub.y = 0;
+			sub.w = width; sub.h = height;
+			sub.rect = false;
+			subs.push_back(sub);
+
+			in_atlas = true;
+			bound = true;
+			return;
+		}
+
 		GenerateSubTexMatrix();
 
 		// If necessary, convert canvas to RGB or RGBA
@@ -90,7 +109,7 @@ namespace DCDraw
 			// Create texture
 			GLuint tex_t = sub.rect ? /*GL_TEXTURE_RECTANGLE_NV*/0 : GL_TEXTURE_2D;
 			glGenTextures(1, &sub.tex_id);
-			glBindTexture  (tex_t, sub.tex_id);
+			BindTexture    (sub.tex_id);
 			glTexImage2D   (tex_t, 0, pixelSize, sub.tex_w, sub.tex_h, 0, (pixelSize == 4) ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, rgba);
 			glTexParameteri(tex_t, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 			glTexParameteri(tex_t, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -107,26 +126,33 @@ namespace DCDraw
 	{
 		if (!bound) return;
 
-		for (size_t s=0; s<subs.size(); ++s)
+		if (in_atlas)
 		{
-			SubTex &sub = subs[s];
-			glDeleteTextures(1, &sub.tex_id);
+			AtlasRemove(region);
+			in_atlas = false;
+		} else {
+			for (size_t s=0; s<subs.size(); ++s)
+			{
+				SubTex &sub = subs[s];
+				DeleteTexture(sub.tex_id);
+			}
 		}
+		subs.clear();
 		bound = false;
 	}
 
-	void Texture::Draw(Transform &t, Color &col, Clip &clip)
+	// vertex of a quad in image coordinates, transformed by m (see Texture::Draw)
+	static inline void SetVertex(BatchVertex &vertex, const float m[6], float x, float y, float u, float v, const Color &col)
 	{
-		if (!bound) return;
-
-		glMatrixMode(GL_MODELVIEW);
-		glPushMatrix();
-		glTranslatef(t.GetTrans().x, t.GetTrans().y, 0);
-		glRotatef(t.GetRotation(), 0, 0, 1.0f);
-		glScalef(t.GetScale().x, t.GetScale().y, 0);
-		glTranslatef(-t.GetOrigin().x, -t.GetOrigin().y, 0);
-		glColor4ub(col.r, col.g, col.b, col.a);
+		vertex.x = m[0] * x + m[1] * y + m[2];
+		vertex.y = m[3] * x + m[4] * y + m[5];
+		vertex.u = u;
+		vertex.v = v;
+		vertex.r = col.r; vertex.g = col.g; vertex.b = col.b; vertex.a = col.a;
+	}
 
+	bool Texture::ClipSub(const SubTex &sub, Clip &clip, ClippedSub &out)
+	{
 		int clip_x, clip_y, clip_w, clip_h;
 		if (!clip.GetClipping(clip_x, clip_y, clip_w, clip_h)) {
 			clip_x = clip_y = 0;
@@ -136,64 +162,99 @@ namespace DCDraw
 		int clip_x2 = clip_x + clip_w;
 		int clip_y2 = clip_y + clip_h;
 
+		int x1 = sub.x, y1 = sub.y;
+		int x2 = sub.x + sub.w;
+		int y2 = sub.y + sub.h;
+
+		if (x1 >= clip_x2 || y1 >= clip_y2) return false;
+		if (x2 <= clip_x  || y2 <= clip_y ) return false;
+
+		float u1=sub.tex_x, v1=sub.tex_y, u2=sub.tex_x+sub.w, v2=sub.tex_y+sub.h;
+
+		if (x2 > clip_x2) {
+			u2 = sub.tex_x + clip_x2 - x1;
+			x2 = clip_x2;
+		}
+
+		if (y2 > clip_y2) {
+			v2 = sub.tex_y + clip_y2 - y1;
+			y2 = clip_y2;
+		}
+
+		if (x1 < clip_x) {
+			u1 = sub.tex_x + clip_x - x1;
+			x1 = clip_x;
+		}
+
+		if (y1 < clip_y) {
+			v1 = sub.tex_y + clip_y - y1;
+			y1 = clip_y;
+		}
+
+		if (!sub.rect) {
+			u1 /= sub.tex_w; v1 /= sub.tex_h;
+			u2 /= sub.tex_w; v2 /= sub.tex_h;
+		}
+
+		out.x1 = x1 - clip_x; out.y1 = y1 - clip_y;
+		out.x2 = x2 - clip_x; out.y2 = y2 - clip_y;
+		out.u1 = u1; out.v1 = v1;
+		out.u2 = u2; out.v2 = v2;
+		return true;
+	}
+
+	void Texture::Draw(Transform &t, Color &col, Clip &clip)
+	{
+		if (!bound) return;
+
+		// translate * rotate * scale * translate(-origin), on the CPU so the quads can be batched
+		float angle = t.GetRotation() * (float)M_PI / 180.0f;
+		float cos_a = std::cos(angle), sin_a = std::sin(angle);
+		float sx = t.GetScale().x, sy = t.GetScale().y;
+		float ox = t.GetOrigin().x, oy = t.GetOrigin().y;
+		float m[6] = {
+			cos_a * sx, -sin_a * sy, t.GetTrans().x - cos_a * sx * ox + sin_a * sy * oy,
+			sin_a * sx,  cos_a * sy, t.GetTrans().y - sin_a * sx * ox - cos_a * sy * oy
+		};
+
 		const size_t num_subs = subs.size();
 		for (size_t s=0; s<num_subs; ++s)
 		{
 			SubTex &sub = subs[s];
-			int x1 = sub.x, y1 = sub.y;
-			int x2 = sub.x + sub.w;
-			int y2 = sub.y + sub.h;
-
-			if (x1 >= clip_x2 || y1 >= clip_y2) continue;
-			if (x2 <= clip_x  || y2 <= clip_y ) continue;
+			ClippedSub c;
+			if (!ClipSub(sub, clip, c)) continue;
 
-			float u1=0, v1=0, u2=sub.w, v2=sub.h;
+			// Draw texture
+			BatchVertex quad[4];
+			SetVertex(quad[0], m, c.x1, c.y1, c.u1, c.v1, col);
+			SetVertex(quad[1], m, c.x2, c.y1, c.u2, c.v1, col);
+			SetVertex(quad[2], m, c.x2, c.y2, c.u2, c.v2, col);
+			SetVertex(quad[3], m, c.x1, c.y2, c.u1, c.v2, col);
+			BatchQuad(sub.tex_id, quad);
+		}
+	}
 
-			if (x2 > clip_x2) {
-				u2 = clip_x2 - x1;
-				x2 = clip_x2;
-			}
+	void Texture::Draw(Mesh &mesh, int x, int y, Clip &clip)
+	{
+		if (!bound) return;
 
-			if (y2 > clip_y2) {
-				v2 = clip_y2 - y1;
-				y2 = clip_y2;
-			}
+		static const Color col; // (ignored by the mesh)
+		const float m[6] = { 1, 0, (float)x, 0, 1, (float)y };
 
-			if (x1 < clip_x) {
-				u1 = clip_x - x1;
-				x1 = clip_x;
-			}
+		const size_t num_subs = subs.size();
+		for (size_t s=0; s<num_subs; ++s)
+		{
+			SubTex &sub = subs[s];
+			ClippedSub c;
+			if (!ClipSub(sub, clip, c)) continue;
 
-			if (y1 < clip_y) {
-				v1 = clip_y - y1;
-				y1 = clip_y;
-			}
-			
-			// Draw texture
-			GLuint tex_t = sub.rect ? /*GL_TEXTURE_RECTANGLE_NV*/0 : GL_TEXTURE_2D;
-			if (sub.rect) {
-				//tex_t = GL_TEXTURE_RECTANGLE_NV;
-			} else {
-				u1 /= sub.tex_w; v1 /= sub.tex_h;
-				u2 /= sub.tex_w; v2 /= sub.tex_h;
-				tex_t = GL_TEXTURE_2D;
-			}
-			
-			glEnable(tex_t);
-			glBindTexture(tex_t, sub.tex_id);
-			
-			glBegin(GL_QUADS);
-			glTexCoord2f(u1, v1); glVertex2f(x1-clip_x, y1-clip_y);
-			glTexCoord2f(u2, v1); glVertex2f(x2-clip_x, y1-clip_y);
-			glTexCoord2f(u2, v2); glVertex2f(x2-clip_x, y2-clip_y);
-			glTexCoord2f(u1, v2); glVertex2f(x1-clip_x, y2-clip_y);
-			glEnd();
-
-			glDisable(tex_t);
-			
+			BatchVertex quad[4];
+			SetVertex(quad[0], m, c.x1, c.y1, c.u1, c.v1, col);
+			SetVertex(quad[1], m, c.x2, c.y1, c.u2, c.v1, col);
+			SetVertex(quad[2], m, c.x2, c.y2, c.u2, c.v2, col);
+			SetVertex(quad[3], m, c.x1, c.y2, c.u1, c.v2, col);
+			mesh.AddQuad(sub.tex_id, quad);
 		}
-
-		glPopMatrix();
 	}
 
 
@@ -239,6 +300,7 @@ namespace DCDraw
 				{
 					SubTex sub;
 					sub.rect = false; // POT-Texture
+					sub.tex_x = sub.tex_y = 0;
 					sub.x = pos_x; sub.y = pos_y;
 					sub.w = sub.tex_w = x_sizes[x];
 					sub.h = sub.tex_h = y_sizes[y];
@@ -253,6 +315,7 @@ namespace DCDraw
 		} else { // Use rectangular textures extension
 			SubTex sub;
 			sub.rect = true;
+			sub.tex_x = sub.tex_y = 0;
 			sub.x = 0;
 			sub.y = 0;
 			sub.w = sub.tex_w = width;
@@ -14,6 +14,8 @@
 #include "transform.h"
 #include "color.h"
 #include "clip.h"
+#include "atlas.h"
+#include "mesh.h"
 
 namespace DCDraw
 {
@@ -48,6 +50,9 @@ namespace DCDraw
 			Draw(t, col, clip);
 		}
 
+		// Record the (untransformed) quads at x, y into mesh instead of drawing them
+		void Draw(DCDraw::Mesh &mesh, int x, int y, DCDraw::Clip &clip);
+
 	private:
 		void GenerateSubTexMatrix();
 		void Bind(DCDraw::Canvas &canvas);
@@ -60,10 +65,22 @@ namespace DCDraw
 		{
 			GLuint tex_id;
 			int tex_w, tex_h; // texture size
+			int tex_x, tex_y; // position in the texture (atlas page)
 			int x, y, w, h;   // contained image
 			bool rect;        // Is NPOT texture?
 		};
 		std::vector<SubTex> subs;
+
+		bool in_atlas;     // subs[0] is a region of a shared atlas page
+		AtlasRegion region;
+
+		// Part of a sub-texture inside the clip rectangle, in clipped image and texture coordinates
+		struct ClippedSub
+		{
+			float x1, y1, x2, y2;
+			float u1, v1, u2, v2;
+		};
+		bool ClipSub(const SubTex &sub, DCDraw::Clip &clip, ClippedSub &out);
 	};
 }
 
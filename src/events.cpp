@@ -19,6 +19,7 @@
 
 #include "events.h"
 
+#include <functional>
 #include <memory>
 
 using namespace std;
@@ -74,6 +75,11 @@ unsigned EventHandler::Match(const std::string &name, std::vector<CLValue> &valu
     // 1) No match if name is different
     if (name != GetName()) return 0;
 
+    return MatchArguments(values);
+}
+
+unsigned EventHandler::MatchArguments(std::vector<CLValue> &values) // returns a score, or 0 if no match
+{
     // 2) No match if argc is different
     if (values.size() != GetArgumentCount()) return 0;
 
@@ -102,11 +108,16 @@ unsigned EventHandler::Match(const std::string &name, std::vector<CLValue> &valu
 
 CLValue EventHandler::Execute(CLContext *context, std::vector<CLValue> &values) // execute, permit multithreading
 {
-    CLValue thread(new CLThread(context));
+    CLValue thread = context->newThread();
     GET_THREAD(thread)->init(event_function, values, CLValue::Null()/*self*/);
     return thread;
 }
 
+CLValue EventHandler::Call(CLContext *context, std::vector<CLValue> &values) // execute synchronously
+{
+    return context->call(event_function, CLValue::Null()/*self*/, values);
+}
+
 ////////////////////////////////////////////////////////////////
 // CL2 GARBAGE COLLECTION                                     //
 ////////////////////////////////////////////////////////////////
@@ -169,7 +180,8 @@ void EventHandler::Load(CLSerialLoader &S) {
 // CONSTRUCTOR/DESTRUCTOR                                     //
 ////////////////////////////////////////////////////////////////
 
-EventManager::EventManager() {
+EventManager::EventManager()
+        : index_size(0) {
     Clear();
 }
 
@@ -178,15 +190,20 @@ EventManager::~EventManager() = default;
 void EventManager::Clear() {
     handlers.clear();
     classes.clear();
+    index.clear();
+    index_size = 0;
 }
 
-void EventManager::Update(float dt) // each frame
+void EventManager::Update(CLContext *context, float dt) // each frame
 {
-    // Release references to finished threads, so they can be gc'd next time.
+    // Release references to finished threads, so they can be reused for the next events.
     auto ec_it = classes.begin(), ec_end = classes.end();
     for (; ec_it != ec_end; ++ec_it) {
         CLValue &V = ec_it->second.thread;
-        if (!V.isNull() && !GET_THREAD(V)->isRunning()) V.setNull();
+        if (!V.isNull() && !GET_THREAD(V)->isRunning()) {
+            context->recycleThread(V);
+            V.setNull();
+        }
     }
 }
 
@@ -197,6 +214,49 @@ void EventManager::Update(float dt) // each frame
 void EventManager::AddEventHandler(EventHandler handler) {
     AddEventClassEntry(handler.GetClass());
     handlers.push_back(handler);
+    IndexHandler(handlers.back());
+}
+
+size_t EventManager::MatchKey(CLValue &value) {
+    switch (value.type) {
+        case CL_INTEGER:
+        case CL_FLOAT:
+            return std::hash<double>()(value.toFloat()); // 1 == 1.0
+        case CL_NULL:
+            return 0;
+        case CL_BOOLEAN:
+            return value.value.boolean ? 1 : 2;
+        case CL_STRING:
+            return std::hash<std::string>()(GET_STRING(value)->get());
+        case CL_EXTERNALFUNCTION:
+            return std::hash<std::string>()(GET_EXTERNALFUNCTION(value)->getFuncID());
+        default:
+            return std::hash<void *>()(value.value.object); // other objects are only equal to themselves
+    }
+}
+
+void EventManager::IndexHandler(EventHandler &handler) {
+    IndexEntry entry;
+    entry.order = index_size++;
+    entry.handler = &handler;
+    entry.ec = &classes[handler.GetClass()];
+
+    NameIndex &name_index = index[handler.GetName()];
+    if (handler.HasFirstArgument()) {
+        name_index.by_first[MatchKey(handler.GetFirstArgument())].push_back(entry);
+    } else {
+        name_index.any_first.push_back(entry);
+    }
+}
+
+void EventManager::BuildIndex() {
+    index.clear();
+    index_size = 0;
+
+    for (auto &handler : handlers) {
+        AddEventClassEntry(handler.GetClass());
+        IndexHandler(handler);
+    }
 }
 
 ////////////////////////////////////////////////////////////////
@@ -246,35 +306,53 @@ bool EventManager::IsSuspended(const std::string &event_class) {
 // SIGNAL EVENTS                                              //
 ////////////////////////////////////////////////////////////////
 
-CLValue EventManager::Signal(CLContext *context, const std::string &event_name, std::vector<CLValue> &values) {
-    auto it = handlers.begin(), end = handlers.end();
-    EventHandler *best_match = nullptr;
-    unsigned best_score = 0;
-
-    while (it != end) {
-        EventHandler &handler = *it;
-        ++it;
-        unsigned score = handler.Match(event_name, values);
+void EventManager::FindInBucket(IndexBucket &bucket, std::vector<CLValue> &values, const IndexEntry *&best, unsigned &best_score) {
+    for (auto &entry : bucket) {
+        unsigned score = entry.handler->MatchArguments(values);
 
         if (score == 0) continue;
-        if (score > best_score) {
+        if ((score > best_score) || ((score == best_score) && (entry.order < best->order))) {
             // check if event class is suspended
-            auto ec_it = classes.find(handler.GetClass());
-            if (ec_it->second.suspended > 0) continue;
+            if (entry.ec->suspended > 0) continue;
 
             best_score = score;
-            best_match = &handler;
+            best = &entry;
         }
     }
+}
 
+EventHandler *EventManager::FindHandler(const std::string &event_name, std::vector<CLValue> &values) {
+    auto it = index.find(event_name);
+    if (it == index.end()) return nullptr;
+
+    // Highest score wins, the first registered handler on a tie
+    const IndexEntry *best = nullptr;
+    unsigned best_score = 0;
+
+    NameIndex &name_index = it->second;
+    FindInBucket(name_index.any_first, values, best, best_score);
+
+    if (!values.empty() && !name_index.by_first.empty()) {
+        auto bucket_it = name_index.by_first.find(MatchKey(values[0]));
+        if (bucket_it != name_index.by_first.end()) FindInBucket(bucket_it->second, values, best, best_score);
+    }
+
+    return best ? best->handler : nullptr;
+}
+
+CLValue EventManager::Signal(CLContext *context, const std::string &event_name, std::vector<CLValue> &values) {
+    EventHandler *best_match = FindHandler(event_name, values);
     if (best_match == nullptr) return CLValue();
 
-    // Kill old event thread if any.
+    // Kill old event thread if any, reuse it if possible.
     auto ec_it = classes.find(best_match->GetClass());
     EventClass &ec = ec_it->second;
-    if (!ec.thread.isNull() && (GET_THREAD(ec.thread)->isRunning())) {
-        //cout << "Killing thread, tag is " << GET_THREAD(ec.thread)->tag << endl;
-        GET_THREAD(ec.thread)->kill();
+    if (!ec.thread.isNull()) {
+        if (GET_THREAD(ec.thread)->isRunning()) {
+            //cout << "Killing thread, tag is " << GET_THREAD(ec.thread)->tag << endl;
+            GET_THREAD(ec.thread)->kill();
+        }
+        context->recycleThread(ec.thread);
     }
 
     ec.thread = best_match->Execute(context, values);
@@ -282,6 +360,13 @@ CLValue EventManager::Signal(CLContext *context, const std::string &event_name,
     return ec.thread;
 }
 
+CLValue EventManager::Call(CLContext *context, const std::string &event_name, std::vector<CLValue> &values) {
+    EventHandler *best_match = FindHandler(event_name, values);
+    if (best_match == nullptr) return CLValue();
+
+    return best_match->Call(context, values);
+}
+
 ////////////////////////////////////////////////////////////////
 // SAVE & LOAD                                                //
 ////////////////////////////////////////////////////////////////
@@ -333,6 +418,8 @@ void EventManager::Load(CLSerialLoader &S) {
         S.IO(classes[class_id].suspended);
         classes[class_id].thread = CLValue::load(S);
     }
+
+    BuildIndex();
 }
 
 ////////////////////////////////////////////////////////////////
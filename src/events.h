@@ -26,6 +26,7 @@
 #include <vector>
 #include <list>
 #include <map>
+#include <unordered_map>
 
 class EventHandler {
 public:
@@ -46,9 +47,14 @@ public:
     size_t GetArgumentCount() { return args.size(); }
 
     unsigned Match(const std::string &name, std::vector<CLValue> &values); // returns a score, or 0 if no match
+    unsigned MatchArguments(std::vector<CLValue> &values);                 // same, name already known to match
+
+    bool HasFirstArgument() { return !args.empty() && !args[0].wildcard; }
+    CLValue &GetFirstArgument() { return args[0].value; }
 
     // EXECUTE EVENT ///////////////////////////////////////////////
     CLValue Execute(CLContext *context, std::vector<CLValue> &values); // execute, permitting multithreading
+    CLValue Call(CLContext *context, std::vector<CLValue> &values);    // execute synchronously, return result
 
     // GARBAGE COLLECTION
     void MarkObjects();
@@ -81,7 +87,7 @@ public:
     ~EventManager();
 
     void Clear();
-    void Update(float dt); // each frame
+    void Update(CLContext *context, float dt); // each frame
 
     // ADD EVENT HANDLERS //////////////////////////////////////////
     void AddEventHandler(EventHandler handler);
@@ -93,6 +99,7 @@ public:
 
     // SIGNAL EVENTS ///////////////////////////////////////////////
     CLValue Signal(CLContext *context, const std::string &event_name, std::vector<CLValue> &values);
+    CLValue Call(CLContext *context, const std::string &event_name, std::vector<CLValue> &values); // without thread, returns result
 
     // GARBAGE COLLECTION //////////////////////////////////////////
     void MarkObjects();
@@ -107,6 +114,7 @@ private:
     EventHandlerList handlers;
 
     void AddEventClassEntry(const std::string &event_class);
+    EventHandler *FindHandler(const std::string &event_name, std::vector<CLValue> &values); // best match, or nullptr
 
     struct EventClass {
         EventClass() : suspended(0) {}
@@ -118,6 +126,28 @@ private:
 
     typedef std::map<std::string, EventClass> EventClassMap;
     EventClassMap classes;
+
+    // Handler index: only handlers with the event's name and a first argument that can be
+    // equal to the signalled one are scored. Buckets are in registration order.
+    struct IndexEntry {
+        size_t order;           // position in 'handlers', breaks score ties
+        EventHandler *handler;
+        EventClass *ec;         // class of the handler
+    };
+    typedef std::vector<IndexEntry> IndexBucket;
+
+    struct NameIndex {
+        IndexBucket any_first;                             // no arguments or wildcard first argument
+        std::unordered_map<size_t, IndexBucket> by_first;  // by MatchKey() of the first argument
+    };
+
+    std::unordered_map<std::string, NameIndex> index;
+    size_t index_size;
+
+    static size_t MatchKey(CLValue &value); // equal (op_eq) values have equal keys
+    void IndexHandler(EventHandler &handler);
+    void BuildIndex();
+    static void FindInBucket(IndexBucket &bucket, std::vector<CLValue> &values, const IndexEntry *&best, unsigned &best_score);
 };
 
 #endif
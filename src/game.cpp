@@ -29,7 +29,7 @@ using namespace std;
 // CONSTRUCTOR/DESTRUCTOR                                 //
 ////////////////////////////////////////////////////////////
 
-Game_::Game_() : loaded(false) {
+Game_::Game_() : loaded(false), script_budget(5000), save_generation(0), save_seq(0), save_job(0) {
     context.addModule(&math_module);
     context.addModule(&sushi_module);
 }
@@ -61,19 +61,31 @@ void Game_::Start() // (Re)Start a new game
     // initialize event manager, camera
     event_manager.Clear();
     timer_manager.Clear();
+    input_queue.Clear();
     camera.Clear();
 
     // load & build scenes
     cout << "Init game" << this << endl;
 
     const std::string &scene_file = GetConfiguration().GetSceneFile();
-    if (!scene_file.empty()) {
+    const std::string &boot_image = GetConfiguration().GetBootImage();
+    if (!boot_image.empty() && LoadBootImage(boot_image)) {
+        cout << "Restored game from boot image " << boot_image << endl;
+    } else if (!scene_file.empty()) {
         GameLoader gameloader(&context, scene_file);
         gameloader.Parse();
         gameloader.RunPrologScripts();
         gameloader.ParseScenes();
         gameloader.RunSceneScripts();
         gameloader.RunStartScripts();
+
+        if (!boot_image.empty()) {
+            // everything the state was built from
+            std::vector<std::string> inputs = CLScriptLibrary::getPaths();
+            inputs.push_back(scene_file);
+            inputs.insert(inputs.end(), gameloader.GetSceneFiles().begin(), gameloader.GetSceneFiles().end());
+            SaveBootImage(boot_image, inputs);
+        }
     }
     cout << "done init game" << endl;
 
@@ -86,7 +98,10 @@ void Game_::Stop() // Kill current game
 
     event_manager.Clear();
     timer_manager.Clear();
+    input_queue.Clear();
     camera.Clear();
+    save_requests.clear();
+    save_chain.clear();
     context.clear(); // clear script vm
 
     loaded = false;
@@ -124,6 +139,9 @@ void Game_::Mainloop() // Update & Draw
     // count frames
     ++frame_count;
 
+    // run handlers for the ui-events since the last frame
+    DispatchInput();
+
     // update timer objects
     timer_manager.Update(diff);
 
@@ -133,16 +151,20 @@ void Game_::Mainloop() // Update & Draw
     // draw camera
     camera.Draw();
 
-    // keep scripts alive
-    context.roundRobin();
+    // deliver results of native jobs, wake sleeping scripts, keep scripts alive (within the frame's script budget)
+    context.completeJobs();
+    context.tick(diff);
+    context.schedule(script_budget);
 
-    // fire user-draw event
+    // fire user-draw event, synchronously: the handler can't yield or wait
     std::vector<CLValue> args;
-    CLValue thr = event_manager.Signal(&context, "draw", args);
-    if (!thr.isNull()) GET_THREAD(thr)->run();
+    event_manager.Call(&context, "draw", args);
 
     // update event manager
-    event_manager.Update(diff);
+    event_manager.Update(&context, diff);
+
+    // take the snapshots for saves requested by scripts, now that no script is running
+    SaveRequested();
 
     // collect garbage every 100 frames
     static int C = 0;
@@ -164,20 +186,48 @@ void Game_::Mainloop() // Update & Draw
 
 void Game_::OnButtonDown(const std::string &key_name, int key_ascii) {
     if (!loaded) return;
+    input_queue.PushKeyDown(GetTime(), key_name, key_ascii);
+}
+
+void Game_::OnMouseDown(int x, int y, int btn) {
+    if (!loaded) return;
+    input_queue.PushMouseDown(GetTime(), x, y, btn);
+}
+
+void Game_::OnMouseMove(int x, int y) {
+    if (!loaded) return;
+    input_queue.PushMouseMove(GetTime(), x, y);
+}
+
+void Game_::DispatchInput() // signal queued ui-events, in order
+{
+    InputEvent event;
+    while (input_queue.Pop(event)) {
+        switch (event.type) {
+            case InputEvent::MOUSE_MOVE:
+                DispatchMouseMove(event.x, event.y);
+                break;
+            case InputEvent::MOUSE_DOWN:
+                DispatchMouseDown(event.x, event.y, event.button);
+                break;
+            case InputEvent::KEY_DOWN:
+                DispatchButtonDown(event.key_name, event.key_ascii);
+                break;
+        }
+    }
+}
 
+void Game_::DispatchButtonDown(const std::string &key_name, int key_ascii) {
     char key_ascii_str[2] = {0, 0};
     key_ascii_str[0] = (char) key_ascii;
 
     std::vector<CLValue> args;
     args.push_back(CLValue(new CLString(&context, key_name)));
     args.push_back(CLValue(new CLString(&context, key_ascii_str)));
-    CLValue thread = event_manager.Signal(&context, "keydown", args);
-    GET_THREAD(thread)->run();
+    RunInputHandler(event_manager.Signal(&context, "keydown", args));
 }
 
-void Game_::OnMouseDown(int x, int y, int btn) {
-    if (!loaded) return;
-
+void Game_::DispatchMouseDown(int x, int y, int btn) {
     std::vector<CLValue> args;
     args.emplace_back(x);
     args.emplace_back(y);
@@ -193,13 +243,10 @@ void Game_::OnMouseDown(int x, int y, int btn) {
     }
     args.emplace_back(btn);
 
-    CLValue thread = event_manager.Signal(&context, "mousedown", args);
-    GET_THREAD(thread)->run();
+    RunInputHandler(event_manager.Signal(&context, "mousedown", args));
 }
 
-void Game_::OnMouseMove(int x, int y) {
-    if (!loaded) return;
-
+void Game_::DispatchMouseMove(int x, int y) {
     std::vector<CLValue> args;
     args.emplace_back(x);
     args.emplace_back(y);
@@ -214,7 +261,14 @@ void Game_::OnMouseMove(int x, int y) {
         args.emplace_back(CLValue(-1));
     }
 
-    CLValue thread = event_manager.Signal(&context, "mousemove", args);
+    RunInputHandler(event_manager.Signal(&context, "mousemove", args));
+}
+
+void Game_::RunInputHandler(CLValue thread) // run event handler thread now, with input priority
+{
+    if (thread.isNull()) return;
+
+    GET_THREAD(thread)->setPriority(CLThread::PRIORITY_INPUT);
     GET_THREAD(thread)->run();
 }
 
@@ -224,12 +278,7 @@ void Game_::OnMouseMove(int x, int y) {
 
 CLValue Game_::ExecuteScript(const string &file) // execute script by name, without threading
 {
-    CLValue thread(new CLThread(&context));
-    GET_THREAD(thread)->init(CLCompiler::compile(&context, file));
-    GET_THREAD(thread)->enableYield(false);
-    GET_THREAD(thread)->run();
-
-    return GET_THREAD(thread)->getResult();
+    return context.call(CLCompiler::compile(&context, file));
 }
 
 void Game_::GarbageCollect() // perform garbage collection
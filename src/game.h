@@ -21,8 +21,10 @@
 #define GAME_H
 
 #include <string>
+#include <vector>
 
 #include "events.h"
+#include "input.h"
 #include "timers.h"
 #include "camera.h"
 
@@ -48,10 +50,16 @@ public:
 
     // SAVE & LOAD STATES FROM DISK ////////////////////////////
     // (implemented in saveload.cpp)
-    void Save(const std::string &filename);
+    void Save(const std::string &filename); // snapshot now, the file is written in the background
+    void RequestSave(const std::string &filename); // save at the end of the frame (for scripts)
 
     void Load(const std::string &filename);
 
+    // the state after initialization, restored instead of running the scene and start scripts
+    // as long as none of their files changed
+    void SaveBootImage(const std::string &filename, const std::vector<std::string> &inputs);
+    bool LoadBootImage(const std::string &filename);
+
     // FRAME COUNTER, FPS, TIMER ///////////////////////////////
     long GetTime(); // get time in milliseconds
     unsigned long GetFrameCount(); // return number of frames since game start
@@ -60,10 +68,17 @@ public:
     void Mainloop(); // Update & Draw
 
     // LISTENER FOR UI-EVENTS //////////////////////////////////
+    // (queued, the scripts see them at the start of the next frame)
     void OnButtonDown(const std::string &key_name, int key_ascii);
     void OnMouseDown(int x, int y, int btn);
     void OnMouseMove(int x, int y);
 
+    InputQueue &GetInputQueue() { return input_queue; }
+
+    // SCRIPT TIME PER FRAME ///////////////////////////////////
+    void SetScriptBudget(long usecs) { script_budget = usecs; }
+    long GetScriptBudget() { return script_budget; }
+
     // SCRIPTING HELPER FUNCTIONS //////////////////////////////
     CLValue ExecuteScript(const std::string &file); // execute script by name, without threading
     void GarbageCollect(); // perform garbage collection
@@ -85,14 +100,34 @@ private:
     unsigned long last_time;
     unsigned long frame_count;
 
+    long script_budget; // microseconds of script execution per frame
+
     Camera camera;              // camera
     EventManager event_manager; // event manager
     TimerManager timer_manager; // timer manager
+    InputQueue input_queue;     // ui-events of the current frame
+
+    std::vector<std::string> save_requests; // saves requested by scripts during the frame
+
+    // delta savegames (see saveload.cpp)
+    std::string save_chain;       // file of the last save or load, "" if the next save must be a full one
+    unsigned int save_generation; // id of the chain
+    unsigned int save_seq;        // number of deltas in the chain
+    unsigned long save_job;       // job writing the last save (see CLContext::async)
 
     // script engine context
     CLContext context;
     CLMathModule math_module; // math module
     SushiModule sushi_module; // bindings
+
+    void DispatchInput();
+    void DispatchButtonDown(const std::string &key_name, int key_ascii);
+    void DispatchMouseDown(int x, int y, int btn);
+    void DispatchMouseMove(int x, int y);
+    void RunInputHandler(CLValue thread);
+    void SaveRequested();
+    void SaveState(CLSerialSaver &S);
+    void LoadState(CLSerialLoader &S, const std::string &roots);
 };
 
 #endif
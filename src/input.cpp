@@ -0,0 +1,99 @@
+/*
+    MindBender - The MindBender adventure engine
+    Copyright (C) 2006  Gunnar Selke
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "input.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////
+// CONSTRUCTION                                               //
+////////////////////////////////////////////////////////////////
+InputQueue::InputQueue() = default;
+
+InputQueue::~InputQueue() = default;
+
+void InputQueue::Clear() {
+    events.clear();
+    mouse_path.clear();
+}
+
+////////////////////////////////////////////////////////////////
+// QUEUE EVENTS                                               //
+////////////////////////////////////////////////////////////////
+void InputQueue::PushMouseMove(unsigned long time, int x, int y) {
+    InputEvent::Point point = {x, y, time};
+
+    // coalesce with motion that hasn't been dispatched yet
+    if (!events.empty() && (events.back().type == InputEvent::MOUSE_MOVE)) {
+        InputEvent &event = events.back();
+        event.time = time;
+        event.x = x;
+        event.y = y;
+        if (event.path.size() < MAX_PATH)
+            event.path.push_back(point);
+        else
+            event.path.back() = point;
+        return;
+    }
+
+    InputEvent event;
+    event.type = InputEvent::MOUSE_MOVE;
+    event.time = time;
+    event.x = x;
+    event.y = y;
+    event.button = -1;
+    event.key_ascii = 0;
+    event.path.push_back(point);
+    events.push_back(event);
+}
+
+void InputQueue::PushMouseDown(unsigned long time, int x, int y, int button) {
+    InputEvent event;
+    event.type = InputEvent::MOUSE_DOWN;
+    event.time = time;
+    event.x = x;
+    event.y = y;
+    event.button = button;
+    event.key_ascii = 0;
+    events.push_back(event);
+}
+
+void InputQueue::PushKeyDown(unsigned long time, const std::string &key_name, int key_ascii) {
+    InputEvent event;
+    event.type = InputEvent::KEY_DOWN;
+    event.time = time;
+    event.x = event.y = -1;
+    event.button = -1;
+    event.key_name = key_name;
+    event.key_ascii = key_ascii;
+    events.push_back(event);
+}
+
+////////////////////////////////////////////////////////////////
+// DISPATCH                                                   //
+////////////////////////////////////////////////////////////////
+bool InputQueue::Pop(InputEvent &event) {
+    if (events.empty()) return false;
+
+    event = std::move(events.front());
+    events.pop_front();
+
+    if (event.type == InputEvent::MOUSE_MOVE) mouse_path = event.path;
+    return true;
+}
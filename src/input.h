@@ -0,0 +1,79 @@
+/*
+    MindBender - The MindBender adventure engine
+    Copyright (C) 2006  Gunnar Selke
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <string>
+#include <vector>
+#include <deque>
+
+// Input events of one frame, in the order they were received. Consecutive mouse motion is
+// coalesced into a single event with the final position; the positions passed on the way
+// are kept as its path.
+struct InputEvent {
+    enum Type {
+        MOUSE_MOVE,
+        MOUSE_DOWN,
+        KEY_DOWN
+    };
+
+    struct Point {
+        int x, y;
+        unsigned long time;
+    };
+
+    Type type;
+    unsigned long time;       // when received (Game().GetTime()), last motion for MOUSE_MOVE
+    int x, y;                 // mouse position
+    int button;               // MOUSE_DOWN
+    std::string key_name;     // KEY_DOWN
+    int key_ascii;            // KEY_DOWN
+    std::vector<Point> path;  // MOUSE_MOVE: all positions, the last one is (x, y)
+};
+
+class InputQueue {
+public:
+    // CONSTRUCTION ////////////////////////////////////////////////
+    InputQueue();
+    ~InputQueue();
+
+    void Clear();
+
+    // QUEUE EVENTS ////////////////////////////////////////////////
+    void PushMouseMove(unsigned long time, int x, int y);
+    void PushMouseDown(unsigned long time, int x, int y, int button);
+    void PushKeyDown(unsigned long time, const std::string &key_name, int key_ascii);
+
+    // DISPATCH ////////////////////////////////////////////////////
+    bool Pop(InputEvent &event); // next event, false if empty
+    bool IsEmpty() { return events.empty(); }
+
+    // path of the last popped mouse motion (scripts get it as an array of tables with the
+    // slots x, y and time, see GetMousePath in sushimodule.cpp)
+    const std::vector<InputEvent::Point> &GetMousePath() { return mouse_path; }
+
+private:
+    enum { MAX_PATH = 256 }; // further motion only replaces the last point
+
+    std::deque<InputEvent> events;
+    std::vector<InputEvent::Point> mouse_path;
+};
+
+#endif
@@ -148,10 +148,11 @@ int Main_::run(int argc, char **argv) {
     bool cmd_show_cmdline = false;
     bool cmd_disable_gc = false;
     bool cmd_disable_extensions = false;
+    bool cmd_disable_jit = false;
     int cmd_max_tex_size = 0;
     std::string cmd_game_file = "game.xml";
     for (;;) {
-        int cmd = getopt(argc, argv, "ihc:xt:y");
+        int cmd = getopt(argc, argv, "ihc:xt:yj");
         if (cmd == -1) break;
 
         switch (cmd) {
@@ -167,6 +168,9 @@ int Main_::run(int argc, char **argv) {
             case 'y':
                 cmd_disable_gc = true;
                 break;
+            case 'j':
+                cmd_disable_jit = true;
+                break;
             case 't':
                 cmd_max_tex_size = std::atoi(optarg);
                 break;
@@ -188,6 +192,7 @@ int Main_::run(int argc, char **argv) {
         cout << "  -t <size> Set maximum texture width/height (and don't autodetect)" << endl;
         cout << "  -x        Disable use of OpenGL extensions" << endl;
         cout << "  -y        Disable garbage collector" << endl;
+        cout << "  -j        Disable native code compilation of scripts" << endl;
         return 0;
     }
 
@@ -203,6 +208,10 @@ int Main_::run(int argc, char **argv) {
         //...
     }
 
+    if (cmd_disable_jit) {
+        CLJit::setEnabled(false);
+    }
+
     bool error = false;
 
     try {
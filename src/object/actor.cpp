@@ -409,6 +409,7 @@ bool Actor::WalkTo(int to_x, int to_y) {
     // already there?
     if (to_x == GetPositionX() && to_y == GetPositionY()) return true;
 
+    // searched right here, not with FindPathAsync: WalkTo tells the script whether there's a path
     Walk_route = path->FindPath(Vertex(GetPositionX(), GetPositionY()), Vertex(to_x, to_y));
     if (Walk_route.empty()) {
         clog << "Kein Weg gefunden: (" << GetPositionX() << ","
@@ -719,10 +720,7 @@ void Actor::markReferenced() {
 ////////////////////////////////////////////////////////////////////
 
 void Actor::CallEventDraw() {
-    auto *T = new CLThread(getContext());
-    T->init(on_draw, std::vector<CLValue>(), CLValue(this));
-    T->enableYield(false);
-    T->run();
+    getContext()->call(on_draw, CLValue(this));
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -34,10 +34,7 @@ void Item::Draw() {
     if (IsHidden()) return;
 
     if (!on_draw.isNull()) { // Drawing overridden by user?
-        auto *T = new CLThread(getContext());
-        T->init(on_draw, std::vector<CLValue>(), CLValue(this));
-        T->enableYield(false);
-        T->run();
+        getContext()->call(on_draw, CLValue(this));
     } else if (!sprite.isNull()) { // Else, draw default sprite if available
         Sprite *spr = GET_SPRITE(sprite);
         spr->Draw(GetPositionX(), GetPositionY());
@@ -26,11 +26,32 @@ using namespace std;
 Shape::Shape(CLContext *context)
         : TableObject(context),
           method_hit(new CLExternalFunction(context, "adv_shape_hit")),
+          method_find_path_async(new CLExternalFunction(context, "adv_shape_find_path_async")),
           method_find_vertical(new CLExternalFunction(context, "adv_shape_find_vertical")) {
 }
 
 Shape::~Shape() = default;
 
+CLValue Shape::FindPathAsync(Vertex start, Vertex goal) {
+    // cheap for simple shapes, so the future is done right away
+    CLValue future(new CLFuture(getContext()));
+    GET_FUTURE(future)->complete(PathToArray(getContext(), FindPath(start, goal)));
+    return future;
+}
+
+CLValue Shape::PathToArray(CLContext *context, const Path &path) {
+    CLValue key, val, retv = CLValue(new CLArray(context));
+
+    int i = 0;
+    for (auto &vertex : path) {
+        CLValue point = CLValue(new CLTable(context));
+        GET_TABLE(point)->set(key = CLValue(new CLString(context, "x")), val = CLValue(vertex.x));
+        GET_TABLE(point)->set(key = CLValue(new CLString(context, "y")), val = CLValue(vertex.y));
+        GET_ARRAY(retv)->set(key = CLValue(i++), point);
+    }
+    return retv;
+}
+
 bool Shape::FindVertical(int x, int y, int range, int &y_result) {
     // TODO: Specialise this for rectangular, circular shapes!!
 
@@ -63,6 +84,8 @@ void Shape::set(CLValue &key, CLValue &val) {
         const std::string k = GET_STRING(key)->get();
         if (k == "Hit") {
             return;
+        } else if (k == "FindPathAsync") {
+            return;
         } else if (k == "FindVertical") {
             return;
         }
@@ -77,6 +100,9 @@ bool Shape::get(CLValue &key, CLValue &val) {
         if (k == "Hit") {
             val = method_hit;
             return true;
+        } else if (k == "FindPathAsync") {
+            val = method_find_path_async;
+            return true;
         } else if (k == "FindVertical") {
             val = method_find_vertical;
             return true;
@@ -90,6 +116,7 @@ void Shape::markReferenced() {
     TableObject::markReferenced();
 
     method_hit.markObject();
+    method_find_path_async.markObject();
     method_find_vertical.markObject();
 }
 
@@ -207,6 +234,16 @@ Shape::Path PolygonShape::FindPath(Vertex start, Vertex goal) {
     return polygon->FindPath(start, goal);
 }
 
+CLValue PolygonShape::FindPathAsync(Vertex start, Vertex goal) {
+    // polygon resources live until shutdown; their path graphs are built here, on the main
+    // thread, so the job only reads the path
+    const PolygonPath *search_path = &polygon->GetSearchPath();
+    return getContext()->async([search_path, start, goal]() -> CLWorkerPool::Completion {
+        Path path = search_path->findPath(start.x, start.y, goal.x, goal.y);
+        return [path](CLContext *context) { return PathToArray(context, path); };
+    });
+}
+
 void PolygonShape::Save(CLSerialSaver &S, PolygonShape *shape) {
     S.IO(shape->res_id);
 
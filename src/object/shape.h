@@ -40,10 +40,14 @@ public:
 
     virtual bool Hit(int x, int y) = 0;
     virtual Path FindPath(Vertex start, Vertex goal) = 0;
+    virtual CLValue FindPathAsync(Vertex start, Vertex goal); // future of the path as array of tables [x = .., y = ..]
     virtual bool FindVertical(int x, int y, int range, int &y_result);
 
+    static CLValue PathToArray(CLContext *context, const Path &path);
+
 private:
     CLValue method_hit;
+    CLValue method_find_path_async;
     CLValue method_find_vertical;
 
     // gc
@@ -96,6 +100,7 @@ public:
 
     bool Hit(int x, int y) override;
     Path FindPath(Vertex start, Vertex goal) override;
+    CLValue FindPathAsync(Vertex start, Vertex goal) override; // searched in a worker thread
 
     // SAVE & LOAD STATE //////////////////////////////////////////////
     static void Save(CLSerialSaver &S, PolygonShape *shape);
@@ -27,16 +27,17 @@ using namespace std;
 //////////////////////////////////////////////////////////////////
 Timer::Timer(CLContext *context)
         : TableObject(context),
-          time(0) {
-    Game().GetTimerManager().AddTimer(CLValue(this));
+          start(Game().GetTimerManager().GetTime()) {
 }
 
-Timer::~Timer() {
-    Game().GetTimerManager().DelTimer(CLValue(this));
+Timer::~Timer() = default;
+
+float Timer::GetTime() const {
+    return float(Game().GetTimerManager().GetTime() - start);
 }
 
-void Timer::Update(float dt) {
-    time += dt;
+void Timer::SetTime(float time) {
+    start = Game().GetTimerManager().GetTime() - time;
 }
 
 //////////////////////////////////////////////////////////////////
@@ -50,9 +51,9 @@ void Timer::markReferenced() // GC
 
 void Timer::set(CLValue &key, CLValue &val) {
     if (key.type == CL_STRING) {
-        const std::string k = GET_STRING(key)->get();
+        const std::string &k = GET_STRING(key)->get();
         if (k == "time") {
-            this->time = val.toFloat();
+            SetTime(val.toFloat());
             return;
         }
     }
@@ -62,9 +63,9 @@ void Timer::set(CLValue &key, CLValue &val) {
 
 bool Timer::get(CLValue &key, CLValue &val) {
     if (key.type == CL_STRING) {
-        const std::string k = GET_STRING(key)->get();
+        const std::string &k = GET_STRING(key)->get();
         if (k == "time") {
-            val = CLValue(int(this->time));
+            val = CLValue(int(GetTime()));
             return true;
         }
     }
@@ -78,7 +79,8 @@ bool Timer::get(CLValue &key, CLValue &val) {
 
 void Timer::Save(CLSerialSaver &S, Timer *timer) {
     // save time
-    S.IO(timer->time);
+    float time = timer->GetTime();
+    S.IO(time);
 
     // save tableobject data
     TableObject::Save(S, timer);
@@ -89,7 +91,9 @@ Timer *Timer::Load(CLSerialLoader &S) {
     S.addPtr(timer);
 
     // load time
-    S.IO(timer->time);
+    float time;
+    S.IO(time);
+    timer->SetTime(time);
 
     // load tableobject data
     TableObject::Load(S, timer);
@@ -34,7 +34,8 @@ public:
     explicit Timer(CLContext *context);
     ~Timer() override;
 
-    void Update(float dt);
+    float GetTime() const;      // milliseconds since start
+    void SetTime(float time);
 
     // SAVE & LOAD STATE /////////////////////////////////////////////
     static void Save(CLSerialSaver &S, Timer *timer);
@@ -48,7 +49,7 @@ private:
 
     // PRIVATES //////////////////////////////////////////////////////
 private:
-    float time;
+    double start; // TimerManager clock at time 0
 };
 
 #endif
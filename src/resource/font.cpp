@@ -22,15 +22,62 @@
 
 #include "font_bitmap.h"
 
+#include <functional>
 #include <iostream>
+#include <list>
+#include <unordered_map>
+#include <vector>
 
 using namespace std;
 
 namespace Res {
+    ///////////////////////////////////////////////////////////
+    // LAYOUT CACHE                                          //
+    ///////////////////////////////////////////////////////////
+
+    // Texts that were laid out recently, as glyph quads relative to the drawing position.
+    // Talk texts and labels are drawn unchanged for many frames, so most draws are a lookup.
+    struct TextLayout {
+        const Font *font;
+        int width;        // box width, < 0 for a single line
+        std::string text;
+        size_t hash;
+        DCDraw::Mesh mesh;
+    };
+
+    static const size_t MAX_LAYOUTS = 256;
+
+    static std::list<TextLayout> layouts; // most recently drawn first
+    static std::unordered_multimap<size_t, std::list<TextLayout>::iterator> layout_index; // by hash
+
+    static size_t HashLayout(const Font *font, int width, const std::string &text) {
+        size_t h = std::hash<std::string>()(text);
+        h ^= std::hash<const void *>()(font) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<int>()(width) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return h;
+    }
+
+    static void RemoveLayout(std::list<TextLayout>::iterator layout) {
+        auto range = layout_index.equal_range(layout->hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == layout) {
+                layout_index.erase(it);
+                break;
+            }
+        }
+        layouts.erase(layout);
+    }
+
+    ///////////////////////////////////////////////////////////
+    // FONT                                                  //
+    ///////////////////////////////////////////////////////////
+
     Font::Font(const Resource::ID &id) : Resource(Resource::FONT, id) {
     }
 
-    Font::~Font() = default;
+    Font::~Font() {
+        ForgetLayouts();
+    }
 
     void Font::DrawCenter(int x, int y, const std::string &text, FontVisual *visual) {
         y -= GetHeight() / 2;
@@ -39,42 +86,41 @@ namespace Res {
     }
 
     int Font::GetWidth(const std::string &text) {
-        size_t str_len = text.size();
-        int result = GetSpaceWidth() * (str_len - 1);
-        for (size_t i = 0; i < str_len; ++i) {
+        return GetTextWidth(text.c_str(), text.size());
+    }
+
+    int Font::GetTextWidth(const char *text, size_t len) {
+        int result = GetSpaceWidth() * ((int) len - 1);
+        for (size_t i = 0; i < len; ++i) {
             result += GetWidth(text[i]);
         }
         return result;
     }
 
-    void Font::DrawBoxed(int x, int y, int width, const std::string &str, FontVisual *visual) {
+    void Font::BreakLines(int width, const std::string &str, std::vector<Line> &lines) {
         const char *txt = str.c_str();
-        unsigned length = str.length();
+        size_t length = str.length();
 
-        std::vector<std::string> lines;
-
-        std::string line;
+        // Words keep the space in front of them, and are measured one by one
+        Line line = {0, 0};
         int line_len = 0;
 
-        std::string word;
-        int word_len = 0;
-
-        unsigned pos1 = 0;
-        unsigned pos2 = 0;
+        size_t pos1 = 0;
+        size_t pos2 = 0;
 
         bool done = false;
         while (!done) {
-            while ((txt[pos2] != ' ') && (pos2 < length)) pos2++;
-            word = str.substr(pos1, pos2 - pos1);
+            while ((pos2 < length) && (txt[pos2] != ' ')) pos2++;
+            Line word = {pos1, pos2 - pos1};
             pos1 = pos2++;
 
-            word_len = GetWidth(word);
+            int word_len = GetTextWidth(txt + word.start, word.length);
 
-            if ((word_len + line_len <= width) && (line.length() > 0)) {
+            if ((word_len + line_len <= width) && (line.length > 0)) {
                 line_len += word_len;
-                line += word;
+                line.length += word.length;
             } else {
-                lines.push_back(line);
+                if (line.length > 0) lines.push_back(line);
 
                 line = word;
                 line_len = word_len;
@@ -83,12 +129,86 @@ namespace Res {
             if (pos2 >= length) done = true;
         }
 
-        if (line.length() > 0) lines.push_back(line);
+        if (line.length > 0) lines.push_back(line);
+    }
+
+    void Font::DrawBoxed(int x, int y, int width, const std::string &str, FontVisual *visual) {
+        if (width < 0) width = 0; // (negative widths are single lines to the cache)
+        if (DrawCached(x, y, width, str, visual)) return;
+
+        std::vector<Line> lines;
+        BreakLines(width, str, lines);
+
+        int h = GetHeight();
+        size_t num_lines = lines.size();
+        for (size_t i = 0; i < num_lines; ++i) {
+            DrawCenter(x, y - h * (int) (num_lines - i), str.substr(lines[i].start, lines[i].length), visual);
+        }
+    }
+
+    bool Font::LayoutBoxed(int width, const std::string &str, DCDraw::Mesh &mesh) {
+        std::vector<Line> lines;
+        BreakLines(width, str, lines);
 
+        // Lines end above y and are centered on x, see DrawCenter
+        const char *txt = str.c_str();
         int h = GetHeight();
-        int num_lines = lines.size();
-        for (size_t i = 0; i < lines.size(); ++i) {
-            DrawCenter(x, y - h * (num_lines - i), lines[i], visual);
+        size_t num_lines = lines.size();
+        for (size_t i = 0; i < num_lines; ++i) {
+            const char *line = txt + lines[i].start;
+            int line_x = -GetTextWidth(line, lines[i].length) / 2;
+            int line_y = -h * (int) (num_lines - i) - h / 2;
+            if (!Layout(line_x, line_y, line, lines[i].length, mesh)) return false;
+        }
+        return true;
+    }
+
+    bool Font::DrawCached(int x, int y, int width, const std::string &text, FontVisual *visual) {
+        size_t hash = HashLayout(this, width, text);
+
+        TextLayout *layout = nullptr;
+        auto range = layout_index.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            TextLayout &l = *it->second;
+            if (l.font == this && l.width == width && l.text == text) {
+                layouts.splice(layouts.begin(), layouts, it->second);
+                layout = &l;
+                break;
+            }
+        }
+
+        if (!layout) {
+            DCDraw::Mesh mesh;
+            bool ok = (width < 0) ? Layout(0, 0, text.c_str(), text.size(), mesh)
+                                  : LayoutBoxed(width, text, mesh);
+            if (!ok) return false;
+
+            if (layouts.size() >= MAX_LAYOUTS) RemoveLayout(--layouts.end());
+
+            layouts.push_front(TextLayout());
+            layout = &layouts.front();
+            layout->font = this;
+            layout->width = width;
+            layout->text = text;
+            layout->hash = hash;
+            std::swap(layout->mesh, mesh);
+            layout_index.insert(std::make_pair(hash, layouts.begin()));
+        }
+
+        DCDraw::Color color;
+        if (visual) color = DCDraw::Color(visual->r, visual->g, visual->b, visual->a);
+
+        layout->mesh.Draw(x, y, color);
+        return true;
+    }
+
+    void Font::ForgetLayouts() {
+        auto it = layouts.begin();
+        while (it != layouts.end()) {
+            auto next = it;
+            ++next;
+            if (it->font == this) RemoveLayout(it);
+            it = next;
         }
     }
 
@@ -22,6 +22,11 @@
 
 #include "resource.h"
 
+#include "dcdraw/dcdraw.h"
+
+#include <string>
+#include <vector>
+
 namespace Res {
     // Contains info on how to display font
     // (Tinting, Blending, ...)
@@ -45,9 +50,27 @@ namespace Res {
         virtual int GetSpaceWidth() { return 1; } // get space between characters
         virtual int GetWidth(const std::string &text);
 
+    protected:
+        // Record the glyph quads of text (len chars) at x, y; false if the font can't do that
+        virtual bool Layout(int x, int y, const char *text, size_t len, DCDraw::Mesh &mesh) { return false; }
+
+        // Draw text through the layout cache (width < 0: a single line at x, y,
+        // otherwise word wrapped like DrawBoxed); false if the font has no Layout
+        bool DrawCached(int x, int y, int width, const std::string &text, FontVisual *visual);
+
+        void ForgetLayouts(); // when the glyph textures go away
+
     private:
         virtual void Load() = 0;
         virtual void Unload() = 0;
+
+        int GetTextWidth(const char *text, size_t len);
+
+        struct Line {
+            size_t start, length;
+        };
+        void BreakLines(int width, const std::string &str, std::vector<Line> &lines); // word wrap
+        bool LayoutBoxed(int width, const std::string &str, DCDraw::Mesh &mesh);
     };
 
     Font *CreateFontResource(const Resource::ID &id);
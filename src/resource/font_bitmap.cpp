@@ -55,33 +55,30 @@ namespace Res {
         std::vector<Image *>::iterator it, end = images.end();
         for (it = images.begin(); it != end; ++it) (*it)->Unlock();
 
+        ForgetLayouts(); // (they refer to the glyph textures)
         loaded = false;
     }
 
     void Font_Bitmap::Draw(int x, int y, const std::string &text, FontVisual *visual) {
-        size_t len = text.length();
-        const char *txt = text.c_str();
-
-        DCDraw::Transform trans;
-        DCDraw::Color color;
-
-        if (visual) color = DCDraw::Color(visual->r, visual->g, visual->b, visual->a);
+        DrawCached(x, y, -1, text, visual);
+    }
 
+    bool Font_Bitmap::Layout(int x, int y, const char *text, size_t len, DCDraw::Mesh &mesh) {
         int cursor_x = 0;
         for (size_t pos = 0; pos < len; ++pos) {
-            unsigned char ch = txt[pos];
+            unsigned char ch = text[pos];
             Glyph *glyph = glyphs[ch];
 
             if (glyph) {
                 DCDraw::Clip clip(glyph->x, glyph->y, glyph->w, glyph->h);
-                trans.SetTrans(x + cursor_x, y);
-                images[glyph->image_idx]->GetTexture()->Draw(trans, color, clip);
+                images[glyph->image_idx]->GetTexture()->Draw(mesh, x + cursor_x, y, clip);
 
                 cursor_x += glyph->w + 1;
             } else {
                 cursor_x += 8;
             }
         }
+        return true;
     }
 
     int Font_Bitmap::GetHeight() {
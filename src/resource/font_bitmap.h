@@ -39,6 +39,9 @@ namespace Res {
         int GetHeight() override;
         int GetWidth(char ch) override;
 
+    protected:
+        bool Layout(int x, int y, const char *text, size_t len, DCDraw::Mesh &mesh) override;
+
     private:
         void LoadXML();
         void LoadGlyphElement(TiXmlElement *glyph_elem);
@@ -76,6 +76,11 @@ namespace Res {
         return path.findPath(start.x, start.y, goal.x, goal.y);
     }
 
+    const PolygonPath &Polygon::GetSearchPath() {
+        path.buildPathGraphs();
+        return path;
+    }
+
     Polygon *CreatePolygonResource(const Resource::ID &id) {
         if (!Manager.ExistsFile(id)) return nullptr; // file not found
 
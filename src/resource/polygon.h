@@ -34,6 +34,10 @@ namespace Res {
         bool Hit(int x, int y);
         std::list<Vertex> FindPath(Vertex start, Vertex goal);
 
+        // The path with its path graphs built, so searches on other threads don't modify it
+        // (the polygon doesn't change after loading its file)
+        const PolygonPath &GetSearchPath();
+
     private:
         void LoadXML();
         void Load() override;
@@ -400,6 +400,14 @@ void PolygonPath::calculateVisibilityGraph(int polygon) const
 	P.valid_pathgraph = true;
 }
 
+void PolygonPath::buildPathGraphs() const
+{
+	for (int i=0; i<polys.size(); ++i)
+	{
+		if (!polys[i].valid_pathgraph) calculateVisibilityGraph(i);
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Find vertices/outlines/polygons in path based on coordinates                                                           //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -69,6 +69,7 @@ public:
 	bool findPolygonAt(int &polygon, int X, int Y) const;
 
 	std::list<Vertex> findPath(int startX, int startY, int goalX, int goalY) const;
+	void buildPathGraphs() const; // findPath builds them on demand; once built, it only reads the path
 
 private:
         struct Polygon
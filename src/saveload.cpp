@@ -19,6 +19,12 @@
 
 #include "game.h"
 
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
 using namespace std;
 
 #include "object/shape.h"
@@ -136,15 +142,73 @@ public:
 };
 
 
-void Game_::Save(const std::string &filename) {
-    GarbageCollect(); // first, perform gc
+// Compress data into a temporary file next to filename and rename it over the old savegame
+// once it's complete, so a crash while saving can't leave a broken save behind.
+static bool WriteFileAtomic(const std::string &filename, const std::string &data, CLCompression::Codec codec, std::string &error) {
+    std::string tmpname = filename + ".tmp";
+    {
+        std::ofstream output(tmpname.c_str(), ios::out | ios::binary | ios::trunc);
+        try {
+            CLCompression::write(output, data, codec);
+        } catch (std::exception &) {
+            output.setstate(ios::failbit);
+        }
+        output.close();
+        if (!output) {
+            error = "can't write " + tmpname;
+            std::remove(tmpname.c_str());
+            return false;
+        }
+    }
 
-    SushiSerializer my_userdata_serializer;
-    std::ofstream outputfile(filename.c_str(), ios::out | ios::binary);
-    CLSerialSaver S(outputfile);
-    S.setUserDataSerializer(&my_userdata_serializer);
+#ifdef _WIN32
+    std::remove(filename.c_str()); // rename doesn't replace existing files here
+#endif
+    if (std::rename(tmpname.c_str(), filename.c_str()) != 0) {
+        error = "can't rename " + tmpname + " to " + filename;
+        std::remove(tmpname.c_str());
+        return false;
+    }
+    return true;
+}
 
-    S.magic(0x4321);
+// Read and decompress a savegame file, false if it's missing or damaged.
+static bool ReadFile(const std::string &filename, std::string &data, std::string &error) {
+    std::ifstream input(filename.c_str(), ios::in | ios::binary);
+    if (!input) {
+        error = "can't open " + filename;
+        return false;
+    }
+    try {
+        CLCompression::read(input, data);
+    } catch (std::exception &e) {
+        error = filename + ": " + e.what();
+        return false;
+    }
+    return true;
+}
+
+// Savegames are chains: a full save of the game, followed by up to MAX_DELTAS delta files
+// (filename.1, filename.2, ..) holding the objects changed since the save before.
+static const unsigned int SAVE_MAGIC = 0x4327;
+static const CLCompression::Codec SAVE_CODEC = CLCompression::DEFLATE;
+static const unsigned int MAX_DELTAS = 8;
+
+static std::string DeltaName(const std::string &filename, unsigned int seq) {
+    std::ostringstream name;
+    name << filename << "." << seq;
+    return name.str();
+}
+
+static unsigned int NewGeneration() { // tells the deltas of a chain from those left over by older ones
+    static unsigned int counter = 0;
+    return (unsigned int) std::time(nullptr) * 2654435761u + ++counter;
+}
+
+// The game state: a block with the roots (engine state and context), followed by the records
+// of the objects referred to (in a delta, only the changed ones).
+void Game_::SaveState(CLSerialSaver &S) {
+    size_t roots = S.beginBlock();
 
     // save frame count
     auto tmp = (int) frame_count;
@@ -162,18 +226,14 @@ void Game_::Save(const std::string &filename) {
     // save timer manager data
     timer_manager.Save(S);
 
-    clog << "Game saved to " << filename << endl;
-}
-
-void Game_::Load(const std::string &filename) {
-    Stop();
+    S.endBlock(roots);
 
-    SushiSerializer my_userdata_serializer;
-    std::ifstream inputfile(filename.c_str(), ios::in | ios::binary);
-    CLSerialLoader S(inputfile, &context);
-    S.setUserDataSerializer(&my_userdata_serializer);
+    context.saveRecords(S);
+}
 
-    S.magic(0x4321);
+// Load the roots, after the records of all files of the chain were read (loadRecords).
+void Game_::LoadState(CLSerialLoader &S, const std::string &roots) {
+    S.pushInput(roots);
 
     // save frame_count, restore last_time
     int tmp;
@@ -193,9 +253,289 @@ void Game_::Load(const std::string &filename) {
     // load timer manager data
     timer_manager.Load(S);
 
+    S.popInput();
+    context.finishLoad(S);
+}
+
+void Game_::Save(const std::string &filename) {
+    context.waitJob(save_job); // the previous save has to be done (or failed) before the next one is chained to it
+
+    // continue the chain of the last save with a delta, or start a new one
+    bool full = (filename != save_chain) || (save_seq >= MAX_DELTAS);
+    if (full) {
+        save_chain = filename;
+        save_generation = NewGeneration();
+        save_seq = 0;
+    } else {
+        ++save_seq;
+    }
+    unsigned int generation = save_generation, seq = save_seq;
+
+    // phase 1: serialize the game state into memory (main thread, scripts must not be running)
+    auto data = std::make_shared<std::string>();
+    {
+        SushiSerializer my_userdata_serializer;
+        std::ostringstream output(ios::out | ios::binary);
+        {
+            CLSerialSaver S(output);
+            S.setUserDataSerializer(&my_userdata_serializer);
+            S.setMode(full ? CLSerialSaver::FULL : CLSerialSaver::DELTA);
+            S.setFunctionRefs(true);
+
+            S.magic(SAVE_MAGIC);
+            S.IO(generation);
+            S.IO(seq);
+
+            SaveState(S);
+            S.finish();
+        }
+        *data = output.str();
+    }
+
+    // phase 2: compress and write the snapshot in the background, scripts get a "saved" event (filename, ok) when it's done
+    context.async([filename, full, seq, data]() -> CLWorkerPool::Completion {
+        std::string error;
+        bool ok = WriteFileAtomic(full ? filename : DeltaName(filename, seq), *data, SAVE_CODEC, error);
+
+        // deltas of the previous chain are useless now
+        if (ok && full) {
+            for (unsigned int i = 1; i <= MAX_DELTAS; ++i) std::remove(DeltaName(filename, i).c_str());
+        }
+
+        return [filename, ok, error](CLContext *context) -> CLValue {
+            if (ok) {
+                clog << "Game saved to " << filename << endl;
+            } else {
+                cerr << "Saving game failed: " << error << endl;
+                Game().save_chain.clear(); // can't build on this one, the next save is a full one
+            }
+
+            std::vector<CLValue> args;
+            args.push_back(CLValue(new CLString(context, filename)));
+            args.push_back(ok ? CLValue::True() : CLValue::False());
+            Game().GetEventManager().Signal(context, "saved", args);
+            return CLValue(ok ? CLValue::True() : CLValue::False());
+        };
+    }, &save_job);
+}
+
+void Game_::RequestSave(const std::string &filename) {
+    save_requests.push_back(filename);
+}
+
+void Game_::SaveRequested() {
+    std::vector<std::string> requests;
+    requests.swap(save_requests);
+    for (auto &filename : requests) Save(filename);
+}
+
+void Game_::Load(const std::string &filename) {
+    context.waitJob(save_job); // a save that's still being written
+
+    // read and verify the chain before the running game is thrown away
+    std::string base, error;
+    if (!ReadFile(filename, base, error)) {
+        cerr << "Loading game failed: " << error << endl;
+        return;
+    }
+
+    std::vector<std::string> deltas;
+    for (;;) {
+        std::string name = DeltaName(filename, deltas.size() + 1), data;
+        std::ifstream deltafile(name.c_str(), ios::in | ios::binary);
+        if (!deltafile) break;
+        deltafile.close();
+
+        if (!ReadFile(name, data, error)) {
+            cerr << "Ignoring rest of savegame chain: " << error << endl;
+            break;
+        }
+        deltas.push_back(data);
+    }
+
+    SushiSerializer my_userdata_serializer;
+    std::istringstream empty(ios::in | ios::binary);
+    CLSerialLoader S(empty, &context);
+    S.setUserDataSerializer(&my_userdata_serializer);
+    S.setLazy(true); // large tables and arrays are loaded when the game gets to them
+
+    std::string roots;
+    unsigned int generation, seq;
+    try {
+        S.pushInput(base);
+        S.magic(SAVE_MAGIC);
+
+        S.IO(generation);
+        S.IO(seq);
+
+        S.readBlock(roots);
+        context.loadRecords(S);
+        S.popInput();
+
+        // replay the deltas of the chain, the last one has the current roots
+        for (auto &data : deltas) {
+            S.pushInput(data);
+
+            unsigned int delta_magic, delta_generation, delta_seq;
+            S.IO(delta_magic);
+            S.IO(delta_generation);
+            S.IO(delta_seq);
+
+            bool valid = (delta_magic == SAVE_MAGIC) && (delta_generation == generation) && (delta_seq == seq + 1);
+            if (valid) {
+                S.readBlock(roots);
+                context.loadRecords(S);
+                ++seq;
+            }
+
+            S.popInput();
+            if (!valid) break; // left over from an older chain
+        }
+
+        // function references are resolved while the roots are loaded, after the running game
+        // is gone: make sure the script files still have the functions (and compile)
+        CLScriptLibrary::check(S);
+    } catch (std::exception &e) {
+        cerr << "Loading game failed: " << e.what() << endl;
+        save_chain.clear(); // (reading the records took over the save ids of the loaded chain)
+        return;
+    }
+
+    Stop();
+
+    LoadState(S, roots);
+
+    // the next save to this file continues the chain
+    save_chain = filename;
+    save_generation = generation;
+    save_seq = seq;
+
     clog << "Game loaded from " << filename << endl;
 
     loaded = true;
 }
 
 
+
+// Boot images: the state after the initialization of a new game (see Game_::Start), with the
+// files it was built from. They're only used while none of these files changed.
+static const unsigned int BOOT_MAGIC = 0x4201;
+
+static bool HashFile(const std::string &filename, unsigned long long &hash) { // FNV-1a
+    std::ifstream input(filename.c_str(), ios::in | ios::binary);
+    if (!input) return false;
+
+    hash = 14695981039346656037ULL;
+    char buffer[4096];
+    while (input.read(buffer, sizeof(buffer)) || input.gcount() > 0) {
+        for (std::streamsize i = 0; i < input.gcount(); ++i) {
+            hash ^= (unsigned char) buffer[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return true;
+}
+
+void Game_::SaveBootImage(const std::string &filename, const std::vector<std::string> &inputs) {
+    auto data = std::make_shared<std::string>();
+    {
+        SushiSerializer my_userdata_serializer;
+        std::ostringstream output(ios::out | ios::binary);
+        {
+            CLSerialSaver S(output);
+            S.setUserDataSerializer(&my_userdata_serializer);
+            S.setMode(CLSerialSaver::FULL); // (with the code of all functions, restoring doesn't compile anything)
+
+            unsigned int tmp;
+            S.IO(tmp = BOOT_MAGIC);
+            S.IO(tmp = SAVE_MAGIC);
+            S.IO(tmp = CLSerializer::VERSION);
+            S.IO(tmp = NUM_OPCODES); // (saved bytecode refers to opcodes by number)
+
+            S.IO(tmp = inputs.size());
+            for (auto &input : inputs) {
+                unsigned long long hash = 0;
+                HashFile(input, hash); // (a missing file never matches on restore)
+
+                std::string path = input;
+                unsigned int hash_lo = (unsigned int) hash, hash_hi = (unsigned int) (hash >> 32);
+                S.IO(path);
+                S.IO(hash_lo);
+                S.IO(hash_hi);
+            }
+
+            CLScriptLibrary::save(S);
+            SaveState(S);
+            S.finish();
+        }
+        *data = output.str();
+    }
+
+    context.async([filename, data]() -> CLWorkerPool::Completion {
+        std::string error;
+        bool ok = WriteFileAtomic(filename, *data, SAVE_CODEC, error);
+
+        return [filename, ok, error](CLContext *) -> CLValue {
+            if (ok) {
+                clog << "Boot image written to " << filename << endl;
+            } else {
+                cerr << "Writing boot image failed: " << error << endl;
+            }
+            return CLValue::Null();
+        };
+    });
+}
+
+bool Game_::LoadBootImage(const std::string &filename) {
+    if (!std::ifstream(filename.c_str(), ios::in | ios::binary)) return false; // not written yet
+
+    std::string data, error;
+    if (!ReadFile(filename, data, error)) {
+        cerr << "Ignoring boot image: " << error << endl;
+        return false;
+    }
+
+    SushiSerializer my_userdata_serializer;
+    std::istringstream empty(ios::in | ios::binary);
+    CLSerialLoader S(empty, &context);
+    S.setUserDataSerializer(&my_userdata_serializer);
+    S.setLazy(true);
+    S.pushInput(data);
+
+    unsigned int boot_magic, save_magic, version, opcodes;
+    S.IO(boot_magic);
+    S.IO(save_magic);
+    S.IO(version);
+    S.IO(opcodes);
+    if ((boot_magic != BOOT_MAGIC) || (save_magic != SAVE_MAGIC) ||
+        (version != CLSerializer::VERSION) || (opcodes != (unsigned int) NUM_OPCODES)) {
+        clog << "Boot image " << filename << " is from another version" << endl;
+        return false;
+    }
+
+    unsigned int count;
+    S.IO(count);
+    for (unsigned int i = 0; i < count; ++i) {
+        std::string path;
+        unsigned int hash_lo, hash_hi;
+        S.IO(path);
+        S.IO(hash_lo);
+        S.IO(hash_hi);
+
+        unsigned long long hash;
+        if (!HashFile(path, hash) || (hash != (((unsigned long long) hash_hi << 32) | hash_lo))) {
+            clog << "Boot image " << filename << " is out of date (" << path << " changed)" << endl;
+            return false;
+        }
+    }
+
+    CLScriptLibrary::load(S);
+
+    std::string roots;
+    S.readBlock(roots);
+    context.loadRecords(S);
+    S.popInput();
+
+    LoadState(S, roots);
+    return true;
+}
@@ -68,6 +68,7 @@ void GameLoader::Parse() {
                 std::string fn = ParseString();
                 auto *sl = new SceneLoader(context, fn);
                 scene_loaders.push_back(sl);
+                scene_files.push_back(fn);
                 //cout << "Scene: " << fn << endl;
                 break;
             }
@@ -40,11 +40,14 @@ public:
     void RunSceneScripts();
     void RunStartScripts();
 
+    const std::list<std::string> &GetSceneFiles() { return scene_files; }
+
 private:
     CLContext *context;
 
     std::list<std::string> prolog_scripts;
     std::list<std::string> run_scripts;
+    std::list<std::string> scene_files;
     std::list<class SceneLoader *> scene_loaders;
 };
 
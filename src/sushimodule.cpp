@@ -47,6 +47,8 @@ static DECL_FUNC(is_suspended);
 static DECL_FUNC(get_ticks);
 static DECL_FUNC(random_);
 static DECL_FUNC(set_cursor);
+static DECL_FUNC(get_mouse_path);
+static DECL_FUNC(save_game);
 
 // member functions
 static DECL_FUNC(sprite_new);
@@ -72,6 +74,7 @@ static DECL_FUNC(room_disable_scaling);
 
 static DECL_FUNC(shape_new);
 static DECL_FUNC(shape_hit);
+static DECL_FUNC(shape_find_path_async);
 static DECL_FUNC(shape_find_vertical);
 
 static DECL_FUNC(item_new);
@@ -121,6 +124,8 @@ SushiModule::SushiModule() : CLModule("adv") {
     registerFunction("GetTime", "adv_get_ticks", &get_ticks);
     registerFunction("Random", "adv_random", &random_);
     registerFunction("SetCursor", "adv_set_cursor", &set_cursor);
+    registerFunction("GetMousePath", "adv_get_mouse_path", &get_mouse_path);
+    registerFunction("SaveGame", "adv_save_game", &save_game);
 
     // sprite constructor/member functions
     registerFunction("Sprite", "adv_sprite_new", &sprite_new);
@@ -150,6 +155,7 @@ SushiModule::SushiModule() : CLModule("adv") {
     // shape constructor/member functions
     registerFunction("Shape", "adv_shape_new", &shape_new);
     registerFunction("adv_shape_hit", &shape_hit);
+    registerFunction("adv_shape_find_path_async", &shape_find_path_async);
     registerFunction("adv_shape_find_vertical", &shape_find_vertical);
 
     // bagitem constructor/member functions
@@ -242,6 +248,10 @@ static DECL_FUNC(exit_thread) {
 
 static DECL_FUNC(add_event) // AddEvent("scumm", "use", arg0, arg1, ..., func)
 {
+    // Handlers run in their own thread, except for "draw": it's called every frame and
+    // must return without yielding, sleeping or waiting (see Game_::Mainloop). Longer work
+    // goes into a thread started with sys.startthread.
+
     const std::string &event_class = GET_STRING(args[0])->get();
     const std::string &event_name = GET_STRING(args[1])->get();
     CLValue event_func = args[args.size() - 1];
@@ -329,6 +339,32 @@ static DECL_FUNC(set_cursor) // SetCursor(sprite)
     return CLValue::Null();
 }
 
+static DECL_FUNC(get_mouse_path) // GetMousePath(): positions of the last mousemove event, array of tables [x = .., y = .., time = ..]
+{
+    const std::vector<InputEvent::Point> &path = Game().GetInputQueue().GetMousePath();
+    CLValue key, val, retv = CLValue(new CLArray(thread.getContext()));
+
+    for (size_t i = 0; i < path.size(); ++i) {
+        CLValue point = CLValue(new CLTable(thread.getContext()));
+        GET_TABLE(point)->set(key = CLValue(new CLString(thread.getContext(), "x")), val = CLValue(path[i].x));
+        GET_TABLE(point)->set(key = CLValue(new CLString(thread.getContext(), "y")), val = CLValue(path[i].y));
+        GET_TABLE(point)->set(key = CLValue(new CLString(thread.getContext(), "time")), val = CLValue(int(path[i].time)));
+        GET_ARRAY(retv)->set(key = CLValue(int(i)), point);
+    }
+    return retv;
+}
+
+static DECL_FUNC(save_game) // SaveGame(filename): saved at the end of the frame, "saved" event (filename, ok) when written
+{
+    if (ARGC(1) && ARG_STR(0)) {
+        Game().RequestSave(GET_STRING(args[0])->get());
+    } else {
+        thread.runtimeError("Invalid arguments: SaveGame(..) function\n"
+                                    "\tExpected: SaveGame(filename); with filename being a string", false);
+    }
+    return CLValue::Null();
+}
+
 ////////////////////////////////////////////////////////////////////////
 // SPRITE METHODS                                                     //
 ////////////////////////////////////////////////////////////////////////
@@ -754,6 +790,21 @@ static DECL_FUNC(shape_hit) // shape.Hit(x, y)
     return shape->Hit(x, y) ? CLValue::True() : CLValue::False();
 }
 
+static DECL_FUNC(shape_find_path_async) // shape.FindPathAsync(x0, y0, x1, y1), use with sys.await
+{
+    if (!ARGC(4) || !ARG_NUM(0) || !ARG_NUM(1) || !ARG_NUM(2) || !ARG_NUM(3) || !IsObj<Shape>(self)) {
+        thread.runtimeError("Invalid arguments: <shape>.FindPathAsync(..) function\n"
+                                    "\tExpected: <shape>.FindPathAsync(x0, y0, x1, y1); with x0, y0, x1, y1 being numeric", false);
+        return CLValue::Null();
+    }
+
+    Shape *shape = GET_SHAPE(self);
+    Vertex start(args[0].toInt(), args[1].toInt());
+    Vertex goal(args[2].toInt(), args[3].toInt());
+
+    return shape->FindPathAsync(start, goal);
+}
+
 static DECL_FUNC(shape_find_vertical) // shape.FindVertical(x, y, range)
 {
     Shape *shape = GET_SHAPE(self);
@@ -19,47 +19,23 @@
 
 #include "timers.h"
 
-#include "object/timer.h"
-
 using namespace std;
 
 ////////////////////////////////////////////////////////////////
 // CONSTRUCTION                                               //
 ////////////////////////////////////////////////////////////////
-TimerManager::TimerManager() {
-    Clear();
+TimerManager::TimerManager()
+        : time(0) {
 }
 
 TimerManager::~TimerManager() = default;
 
 void TimerManager::Clear() {
-    timers.clear();
+    time = 0;
 }
 
 void TimerManager::Update(float dt) {
-    auto it = timers.begin(), end = timers.end();
-    for (; it != end; ++it) {
-        Timer *T = GET_TIMER(*it);
-        T->Update(dt);
-    }
-}
-
-////////////////////////////////////////////////////////////////
-// ADD/REMOVE TIMERS                                          //
-////////////////////////////////////////////////////////////////
-void TimerManager::AddTimer(CLValue timer) {
-    timers.push_back(timer);
-}
-
-void TimerManager::DelTimer(CLValue timer) {
-    Timer *T = GET_TIMER(timer);
-
-    auto it = timers.begin(), end = timers.end();
-    for (; it != end; ++it) {
-        if (GET_TIMER(*it) == T) {
-            it = timers.erase(it);
-        }
-    }
+    time += dt;
 }
 
 ////////////////////////////////////////////////////////////////
@@ -75,10 +51,7 @@ void TimerManager::Load(CLSerializer &S) {
 // GARBAGE COLLECTION                                         //
 ////////////////////////////////////////////////////////////////
 void TimerManager::MarkObjects() {
-    auto it = timers.begin(), end = timers.end();
-    for (; it != end; ++it) {
-        //if (hat ein callback) it->markObject();
-    }
+    // timers are referenced by scripts only
 }
 
 
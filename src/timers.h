@@ -22,8 +22,8 @@
 
 #include <cl2/cl2.h>
 
-#include <list>
-
+// Game clock for script Timer objects. Timers don't need to be ticked, they store the
+// clock value they were started at and compute their time when it is read.
 class TimerManager {
 public:
     // CONSTRUCTION ////////////////////////////////////////////////
@@ -33,9 +33,8 @@ public:
     void Clear();
     void Update(float dt);
 
-    // ADD/REMOVE TIMERS ///////////////////////////////////////////
-    void AddTimer(CLValue timer);
-    void DelTimer(CLValue timer);
+    // CLOCK ///////////////////////////////////////////////////////
+    double GetTime() const { return time; } // milliseconds since Clear()
 
     // SAVE & LOAD /////////////////////////////////////////////////
     void Save(CLSerializer &S);
@@ -45,7 +44,7 @@ public:
     void MarkObjects();
 
 private:
-    std::list<CLValue> timers;
+    double time;
 };
 
 #endif